@@ -0,0 +1,83 @@
+//
+// gcc -std=gnu99 -O2 -o bench_batch bench_batch.c -I/opt/nec/ve/veos/include -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Submission time of many tiny calls by veo_call_async() one by one
+// compared with veo_call_async_batch().
+//
+// usage: ./bench_batch [calls]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ve_offload.h>
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int wait_all(struct veo_thr_ctxt *ctx, uint64_t *reqs, int n)
+{
+  for (int i = 0; i < n; ++i) {
+    uint64_t retval;
+    if (veo_call_wait_result(ctx, reqs[i], &retval) != VEO_COMMAND_OK) {
+      printf("request #%d failed\n", i);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  int ncalls = argc > 1 ? atoi(argv[1]) : 10000;
+
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  uint64_t handle = veo_load_library(proc, "./libvebench.so");
+  uint64_t sym = veo_get_sym(proc, handle, "empty");
+  struct veo_thr_ctxt *ctx = veo_context_open(proc);
+  struct veo_args *args = veo_args_alloc();
+
+  uint64_t *reqs = malloc(sizeof(uint64_t) * ncalls);
+  uint64_t *addrs = malloc(sizeof(uint64_t) * ncalls);
+  struct veo_args **arglist = malloc(sizeof(struct veo_args *) * ncalls);
+  for (int i = 0; i < ncalls; ++i) {
+    addrs[i] = sym;
+    arglist[i] = args;
+  }
+
+  double start = now();
+  for (int i = 0; i < ncalls; ++i)
+    reqs[i] = veo_call_async(ctx, sym, args);
+  double single = now() - start;
+  if (wait_all(ctx, reqs, ncalls) != 0)
+    exit(1);
+
+  start = now();
+  int submitted = veo_call_async_batch(ctx, ncalls, addrs, arglist, reqs);
+  double batch = now() - start;
+  if (submitted != ncalls) {
+    printf("veo_call_async_batch submitted %d of %d\n", submitted, ncalls);
+    exit(1);
+  }
+  if (wait_all(ctx, reqs, ncalls) != 0)
+    exit(1);
+
+  printf("# method  calls  submit[s]  calls/s\n");
+  printf("single  %7d %10.6f %8.0f\n", ncalls, single, ncalls / single);
+  printf("batch   %7d %10.6f %8.0f\n", ncalls, batch, ncalls / batch);
+
+  free(arglist);
+  free(addrs);
+  free(reqs);
+  veo_args_free(args);
+  veo_context_close(ctx);
+  veo_proc_destroy(proc);
+  return 0;
+}
@@ -0,0 +1,112 @@
+//
+// gcc -std=gnu99 -O2 -o bench_gap bench_gap.c -I/opt/nec/ve/veos/include -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Idle gap of VE between consecutive calls submitted back-to-back.
+// Each call returns the user clock counter of VE at its start; the gap
+// is the difference between the starts of consecutive calls, most of
+// which is spent by the pseudo thread between a return and the next
+// start. Arguments in snapshot mode are marshalled on submission; other
+// arguments are marshalled by the pseudo thread.
+//
+// usage: ./bench_gap [calls] [bytes of IN buffer]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ve_offload.h>
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t call_sync(struct veo_thr_ctxt *ctx, uint64_t sym,
+                          struct veo_args *args)
+{
+  uint64_t retval;
+  uint64_t req = veo_call_async(ctx, sym, args);
+  if (veo_call_wait_result(ctx, req, &retval) != VEO_COMMAND_OK) {
+    printf("call failed\n");
+    exit(1);
+  }
+  return retval;
+}
+
+static int cmp(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+// print the median and the mean of gaps between ncalls calls
+static void run(const char *name, struct veo_thr_ctxt *ctx, uint64_t sym,
+                struct veo_args *args, int ncalls, double hz,
+                uint64_t *reqs, uint64_t *stamps)
+{
+  for (int i = 0; i < ncalls; ++i)
+    reqs[i] = veo_call_async(ctx, sym, args);
+  for (int i = 0; i < ncalls; ++i) {
+    if (veo_call_wait_result(ctx, reqs[i], &stamps[i]) != VEO_COMMAND_OK) {
+      printf("call %d failed\n", i);
+      exit(1);
+    }
+  }
+  double mean = (double)(stamps[ncalls - 1] - stamps[0]) / (ncalls - 1);
+  for (int i = 0; i < ncalls - 1; ++i)
+    stamps[i] = stamps[i + 1] - stamps[i];
+  qsort(stamps, ncalls - 1, sizeof(uint64_t), cmp);
+  double median = stamps[(ncalls - 1) / 2];
+  printf("%-9s %7d %10.3f %10.3f\n", name, ncalls, median / hz * 1e6,
+         mean / hz * 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+  int ncalls = argc > 1 ? atoi(argv[1]) : 10000;
+  size_t size = argc > 2 ? atol(argv[2]) : 4096;
+  if (ncalls < 2) {
+    printf("calls must be 2 or more\n");
+    exit(1);
+  }
+
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  uint64_t handle = veo_load_library(proc, "./libvebench.so");
+  uint64_t sym = veo_get_sym(proc, handle, "stamp");
+  struct veo_thr_ctxt *ctx = veo_context_open(proc);
+  struct veo_args *args = veo_args_alloc();
+
+  // calibrate the clock counter of VE against the clock of VH
+  double t0 = now();
+  uint64_t c0 = call_sync(ctx, sym, args);
+  struct timespec ts = { 0, 200 * 1000 * 1000 };
+  nanosleep(&ts, NULL);
+  uint64_t c1 = call_sync(ctx, sym, args);
+  double hz = (c1 - c0) / (now() - t0);
+
+  uint64_t *reqs = malloc(sizeof(uint64_t) * ncalls);
+  uint64_t *stamps = malloc(sizeof(uint64_t) * ncalls);
+  char *buf = calloc(1, size);
+  printf("# %zu bytes on stack; VE clock %.1f MHz\n", size, hz * 1e-6);
+  printf("# args     calls median[us]  mean[us]\n");
+  for (int i = 0; i < 4; ++i)
+    veo_args_set_i64(args, i, i);
+  run("register", ctx, sym, args, ncalls, hz, reqs, stamps);
+  veo_args_set_stack(args, VEO_INTENT_IN, 4, buf, size);
+  run("stack", ctx, sym, args, ncalls, hz, reqs, stamps);
+  veo_args_set_snapshot(args, 1);
+  run("snapshot", ctx, sym, args, ncalls, hz, reqs, stamps);
+
+  free(buf);
+  free(stamps);
+  free(reqs);
+  veo_args_free(args);
+  veo_context_close(ctx);
+  veo_proc_destroy(proc);
+  return 0;
+}
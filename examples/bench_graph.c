@@ -0,0 +1,92 @@
+//
+// gcc -std=gnu99 -O2 -o bench_graph bench_graph.c -I/opt/nec/ve/veos/include -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Time per step of a sequence of calls and transfers submitted one by
+// one compared with the same sequence captured into a graph and
+// replayed by veo_graph_launch().
+//
+// usage: ./bench_graph [steps] [calls per step]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ve_offload.h>
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// one step: write the input, call the kernel ncalls times, read back.
+static uint64_t submit_step(struct veo_thr_ctxt *ctx, uint64_t sym,
+                            struct veo_args *args, uint64_t vebuf,
+                            double *in, double *out, int ncalls)
+{
+  veo_async_write_mem(ctx, vebuf, in, sizeof(*in));
+  for (int i = 0; i < ncalls; ++i)
+    veo_call_async(ctx, sym, args);
+  return veo_async_read_mem(ctx, out, vebuf, sizeof(*out));
+}
+
+int main(int argc, char *argv[])
+{
+  int nsteps = argc > 1 ? atoi(argv[1]) : 1000;
+  int ncalls = argc > 2 ? atoi(argv[2]) : 200;
+
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  uint64_t handle = veo_load_library(proc, "./libvebench.so");
+  uint64_t sym = veo_get_sym(proc, handle, "empty");
+  struct veo_thr_ctxt *ctx = veo_context_open(proc);
+  struct veo_args *args = veo_args_alloc();
+  uint64_t vebuf, retval;
+  double in = 1.0, out = 0.0;
+  if (veo_alloc_mem(proc, &vebuf, sizeof(double)) != 0) {
+    perror("veo_alloc_mem");
+    exit(1);
+  }
+
+  double start = now();
+  for (int s = 0; s < nsteps; ++s) {
+    uint64_t req = submit_step(ctx, sym, args, vebuf, &in, &out, ncalls);
+    if (veo_call_wait_result(ctx, req, &retval) != VEO_COMMAND_OK) {
+      printf("step %d failed\n", s);
+      exit(1);
+    }
+  }
+  double single = now() - start;
+
+  if (veo_graph_begin_capture(ctx) != 0) {
+    printf("veo_graph_begin_capture failed\n");
+    exit(1);
+  }
+  submit_step(ctx, sym, args, vebuf, &in, &out, ncalls);
+  struct veo_graph *graph = veo_graph_end_capture(ctx);
+
+  start = now();
+  for (int s = 0; s < nsteps; ++s) {
+    uint64_t req = veo_graph_launch(ctx, graph);
+    if (veo_call_wait_result(ctx, req, &retval) != VEO_COMMAND_OK) {
+      printf("step %d failed\n", s);
+      exit(1);
+    }
+  }
+  double graphed = now() - start;
+
+  printf("# %d nodes per step\n", ncalls + 2);
+  printf("# method  steps  time/step[us]\n");
+  printf("single  %7d %14.3f\n", nsteps, single / nsteps * 1e6);
+  printf("graph   %7d %14.3f\n", nsteps, graphed / nsteps * 1e6);
+
+  veo_graph_destroy(graph);
+  veo_free_mem(proc, vebuf);
+  veo_args_free(args);
+  veo_context_close(ctx);
+  veo_proc_destroy(proc);
+  return 0;
+}
@@ -0,0 +1,82 @@
+//
+// gcc -std=gnu99 -O2 -o bench_plan bench_plan.c -I/opt/nec/ve/veos/include -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Time per call of a function with 12 scalar arguments and an IN buffer
+// on stack called by veo_call_async() compared with a call plan, when
+// only one scalar argument changes between calls.
+//
+// usage: ./bench_plan [calls] [bytes of IN buffer]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ve_offload.h>
+
+#define NSCALARS 12
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+  int ncalls = argc > 1 ? atoi(argv[1]) : 100000;
+  size_t size = argc > 2 ? atol(argv[2]) : 4096;
+
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  uint64_t handle = veo_load_library(proc, "./libvebench.so");
+  uint64_t sym = veo_get_sym(proc, handle, "empty");
+  struct veo_thr_ctxt *ctx = veo_context_open(proc);
+  struct veo_args *args = veo_args_alloc();
+  char *buf = calloc(1, size);
+  for (int i = 0; i < NSCALARS; ++i)
+    veo_args_set_i64(args, i, i);
+  veo_args_set_stack(args, VEO_INTENT_IN, NSCALARS, buf, size);
+  uint64_t retval;
+
+  double start = now();
+  for (int i = 0; i < ncalls; ++i) {
+    veo_args_set_i64(args, NSCALARS - 1, i);
+    uint64_t req = veo_call_async(ctx, sym, args);
+    if (veo_call_wait_result(ctx, req, &retval) != VEO_COMMAND_OK) {
+      printf("call %d failed\n", i);
+      exit(1);
+    }
+  }
+  double single = now() - start;
+
+  struct veo_call_plan *plan = veo_call_plan_create(ctx, sym, args);
+  if (plan == NULL) {
+    printf("veo_call_plan_create failed\n");
+    exit(1);
+  }
+  start = now();
+  for (int i = 0; i < ncalls; ++i) {
+    veo_args_set_i64(args, NSCALARS - 1, i);
+    uint64_t req = veo_call_plan_launch(plan);
+    if (veo_call_wait_result(ctx, req, &retval) != VEO_COMMAND_OK) {
+      printf("call %d failed\n", i);
+      exit(1);
+    }
+  }
+  double planned = now() - start;
+
+  printf("# %d scalar arguments and %zu bytes on stack\n", NSCALARS, size);
+  printf("# method  calls  time/call[us]\n");
+  printf("single  %7d %14.3f\n", ncalls, single / ncalls * 1e6);
+  printf("plan    %7d %14.3f\n", ncalls, planned / ncalls * 1e6);
+
+  veo_call_plan_destroy(plan);
+  veo_args_free(args);
+  free(buf);
+  veo_context_close(ctx);
+  veo_proc_destroy(proc);
+  return 0;
+}
@@ -0,0 +1,73 @@
+//
+// gcc -std=gnu99 -O2 -o bench_prio bench_prio.c -I/opt/nec/ve/veos/include -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Latency of an 8-byte read queued behind bulk writes on the same
+// context, submitted with VEO_PRIO_NORMAL and with VEO_PRIO_HIGH.
+//
+// usage: ./bench_prio [bulk writes] [bulk size in MiB]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ve_offload.h>
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double measure(struct veo_thr_ctxt *ctx, uint64_t vebulk,
+                      const char *bulk, size_t size, int nbulk,
+                      uint64_t veflag, int prio)
+{
+  uint64_t reqs[nbulk], flag, retval;
+  for (int i = 0; i < nbulk; ++i)
+    reqs[i] = veo_async_write_mem(ctx, vebulk, bulk, size);
+  double start = now();
+  uint64_t req = veo_async_read_mem_prio(ctx, &flag, veflag, sizeof(flag),
+                                         prio);
+  veo_call_wait_result(ctx, req, &retval);
+  double latency = now() - start;
+  for (int i = 0; i < nbulk; ++i)
+    veo_call_wait_result(ctx, reqs[i], &retval);
+  return latency;
+}
+
+int main(int argc, char *argv[])
+{
+  int nbulk = argc > 1 ? atoi(argv[1]) : 8;
+  size_t size = (argc > 2 ? atol(argv[2]) : 64) << 20;
+
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  struct veo_thr_ctxt *ctx = veo_context_open(proc);
+  uint64_t vebulk, veflag;
+  if (veo_alloc_mem(proc, &vebulk, size) != 0 ||
+      veo_alloc_mem(proc, &veflag, sizeof(uint64_t)) != 0) {
+    perror("veo_alloc_mem");
+    exit(1);
+  }
+  char *bulk = calloc(1, size);
+
+  double normal = measure(ctx, vebulk, bulk, size, nbulk, veflag,
+                          VEO_PRIO_NORMAL);
+  double high = measure(ctx, vebulk, bulk, size, nbulk, veflag,
+                        VEO_PRIO_HIGH);
+  printf("# %d writes of %zu MiB queued before an 8-byte read\n",
+         nbulk, size >> 20);
+  printf("# priority  latency[ms]\n");
+  printf("normal %14.3f\n", normal * 1e3);
+  printf("high   %14.3f\n", high * 1e3);
+
+  free(bulk);
+  veo_free_mem(proc, veflag);
+  veo_free_mem(proc, vebulk);
+  veo_context_close(ctx);
+  veo_proc_destroy(proc);
+  return 0;
+}
@@ -0,0 +1,96 @@
+//
+// gcc -std=gnu99 -O2 -o bench_submit bench_submit.c -I/opt/nec/ve/veos/include -pthread -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Submission throughput of veo_call_async() from concurrent producers
+// into one VEO context.
+//
+// usage: ./bench_submit [max producers] [calls in total]
+//
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ve_offload.h>
+
+struct producer {
+  pthread_t thread;
+  pthread_barrier_t *barrier;
+  struct veo_thr_ctxt *ctx;
+  uint64_t sym;
+  struct veo_args *args;
+  int ncalls;
+  uint64_t *reqs;
+  double elapsed;
+};
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *submit(void *arg)
+{
+  struct producer *p = arg;
+  pthread_barrier_wait(p->barrier);
+  double start = now();
+  for (int i = 0; i < p->ncalls; ++i)
+    p->reqs[i] = veo_call_async(p->ctx, p->sym, p->args);
+  p->elapsed = now() - start;
+  return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+  int max_producers = argc > 1 ? atoi(argv[1]) : 16;
+  int total = argc > 2 ? atoi(argv[2]) : 4000;
+
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  uint64_t handle = veo_load_library(proc, "./libvebench.so");
+  uint64_t sym = veo_get_sym(proc, handle, "empty");
+  struct veo_thr_ctxt *ctx = veo_context_open(proc);
+  struct veo_args *args = veo_args_alloc();
+
+  printf("# producers  calls  submit[s]  calls/s\n");
+  for (int np = 1; np <= max_producers; np *= 2) {
+    struct producer p[np];
+    pthread_barrier_t barrier;
+    int ncalls = total / np;
+    pthread_barrier_init(&barrier, NULL, np);
+    for (int i = 0; i < np; ++i) {
+      p[i].barrier = &barrier;
+      p[i].ctx = ctx;
+      p[i].sym = sym;
+      p[i].args = args;
+      p[i].ncalls = ncalls;
+      p[i].reqs = malloc(sizeof(uint64_t) * ncalls);
+      pthread_create(&p[i].thread, NULL, submit, &p[i]);
+    }
+    double elapsed = 0;
+    for (int i = 0; i < np; ++i) {
+      pthread_join(p[i].thread, NULL);
+      if (p[i].elapsed > elapsed)
+        elapsed = p[i].elapsed;
+    }
+    for (int i = 0; i < np; ++i) {
+      for (int j = 0; j < ncalls; ++j) {
+        uint64_t retval;
+        veo_call_wait_result(ctx, p[i].reqs[j], &retval);
+      }
+      free(p[i].reqs);
+    }
+    pthread_barrier_destroy(&barrier);
+    printf("%11d %6d %10.6f %8.0f\n", np, ncalls * np, elapsed,
+           ncalls * np / elapsed);
+  }
+
+  veo_args_free(args);
+  veo_context_close(ctx);
+  veo_proc_destroy(proc);
+  return 0;
+}
@@ -0,0 +1,96 @@
+//
+// gcc -std=gnu99 -O2 -o bench_wait bench_wait.c -I/opt/nec/ve/veos/include -pthread -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Latency of veo_call_wait_result() against the number of threads
+// concurrently waiting for their own requests in one VEO context.
+//
+// usage: ./bench_wait [max waiters] [calls per waiter]
+//
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ve_offload.h>
+
+struct waiter {
+  pthread_t thread;
+  pthread_barrier_t *barrier;
+  struct veo_thr_ctxt *ctx;
+  uint64_t sym;
+  struct veo_args *args;
+  int ncalls;
+  double *latency;
+};
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static void *call_and_wait(void *arg)
+{
+  struct waiter *w = arg;
+  pthread_barrier_wait(w->barrier);
+  for (int i = 0; i < w->ncalls; ++i) {
+    uint64_t retval;
+    double start = now();
+    uint64_t req = veo_call_async(w->ctx, w->sym, w->args);
+    veo_call_wait_result(w->ctx, req, &retval);
+    w->latency[i] = now() - start;
+  }
+  return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+  int max_waiters = argc > 1 ? atoi(argv[1]) : 64;
+  int ncalls = argc > 2 ? atoi(argv[2]) : 1000;
+
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  uint64_t handle = veo_load_library(proc, "./libvebench.so");
+  uint64_t sym = veo_get_sym(proc, handle, "empty");
+  struct veo_thr_ctxt *ctx = veo_context_open(proc);
+  struct veo_args *args = veo_args_alloc();
+
+  printf("# waiters  p50[us]  p99[us]\n");
+  for (int nw = 1; nw <= max_waiters; nw *= 2) {
+    struct waiter w[nw];
+    pthread_barrier_t barrier;
+    double *latency = malloc(sizeof(double) * nw * ncalls);
+    pthread_barrier_init(&barrier, NULL, nw);
+    for (int i = 0; i < nw; ++i) {
+      w[i].barrier = &barrier;
+      w[i].ctx = ctx;
+      w[i].sym = sym;
+      w[i].args = args;
+      w[i].ncalls = ncalls;
+      w[i].latency = latency + i * ncalls;
+      pthread_create(&w[i].thread, NULL, call_and_wait, &w[i]);
+    }
+    for (int i = 0; i < nw; ++i)
+      pthread_join(w[i].thread, NULL);
+    pthread_barrier_destroy(&barrier);
+    int n = nw * ncalls;
+    qsort(latency, n, sizeof(double), compare);
+    printf("%9d %8.1f %8.1f\n", nw, latency[n / 2] * 1e6,
+           latency[(int)(n * 0.99)] * 1e6);
+    free(latency);
+  }
+
+  veo_args_free(args);
+  veo_context_close(ctx);
+  veo_proc_destroy(proc);
+  return 0;
+}
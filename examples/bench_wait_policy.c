@@ -0,0 +1,87 @@
+//
+// gcc -std=gnu99 -O2 -o bench_wait_policy bench_wait_policy.c -I/opt/nec/ve/veos/include -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Round-trip latency of an empty VE function, veo_call_async() followed
+// by veo_call_wait_result(), under each wait policy of VEO contexts.
+//
+// usage: ./bench_wait_policy [calls]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ve_offload.h>
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[])
+{
+  int ncalls = argc > 1 ? atoi(argv[1]) : 10000;
+  static const struct {
+    int policy;
+    const char *name;
+  } policies[] = {
+    { VEO_WAIT_PARK, "park" },
+    { VEO_WAIT_SPIN, "spin" },
+    { VEO_WAIT_ADAPTIVE, "adaptive" },
+  };
+
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  uint64_t handle = veo_load_library(proc, "./libvebench.so");
+  uint64_t sym = veo_get_sym(proc, handle, "empty");
+  struct veo_args *args = veo_args_alloc();
+  double *latency = malloc(sizeof(double) * ncalls);
+
+  printf("# policy   calls  median[us]  p99[us]  mean[us]\n");
+  for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); ++p) {
+    struct veo_thr_ctxt_attr *attr = veo_alloc_thr_ctxt_attr();
+    if (veo_set_thr_ctxt_wait_policy(attr, policies[p].policy) != 0) {
+      perror("veo_set_thr_ctxt_wait_policy");
+      exit(1);
+    }
+    struct veo_thr_ctxt *ctx = veo_context_open_with_attr(proc, attr);
+    veo_free_thr_ctxt_attr(attr);
+    if (ctx == NULL) {
+      perror("veo_context_open_with_attr");
+      exit(1);
+    }
+    // warm up, which also lets the adaptive policy learn the wait time.
+    for (int i = 0; i < 100; ++i) {
+      uint64_t retval;
+      veo_call_wait_result(ctx, veo_call_async(ctx, sym, args), &retval);
+    }
+    double sum = 0;
+    for (int i = 0; i < ncalls; ++i) {
+      uint64_t retval;
+      double start = now();
+      uint64_t req = veo_call_async(ctx, sym, args);
+      veo_call_wait_result(ctx, req, &retval);
+      latency[i] = now() - start;
+      sum += latency[i];
+    }
+    qsort(latency, ncalls, sizeof(double), compare);
+    printf("%-9s %6d %11.2f %8.2f %9.2f\n", policies[p].name, ncalls,
+           latency[ncalls / 2] * 1e6, latency[ncalls * 99 / 100] * 1e6,
+           sum / ncalls * 1e6);
+    veo_context_close(ctx);
+  }
+
+  free(latency);
+  veo_args_free(args);
+  veo_proc_destroy(proc);
+  return 0;
+}
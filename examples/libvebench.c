@@ -0,0 +1,28 @@
+//
+// /opt/nec/ve/bin/ncc -shared -fpic -o libvebench.so libvebench.c
+//
+#include <stdint.h>
+
+uint64_t empty(void)
+{
+  return 0;
+}
+
+uint64_t sum8(int64_t a, uint64_t b, int32_t c, uint32_t d,
+              int16_t e, uint16_t f, int8_t g, uint8_t h)
+{
+  return a + b + c + d + e + f + g + h;
+}
+
+// user clock counter of VE
+static inline uint64_t usrcc(void)
+{
+  uint64_t v;
+  asm volatile("smir %0, %%usrcc" : "=r"(v));
+  return v;
+}
+
+uint64_t stamp(void)
+{
+  return usrcc();
+}
@@ -62,3 +62,13 @@ int test_16(int i16, unsigned int u16)
     printf("VE: argument passed: %hd, %hu\n", i16, u16);
     return 0;
 }
+
+long test_large_inout(long *a, long n)
+{
+	long s = 0;
+	for (long i = 0; i < n; ++i) {
+		s += a[i];
+		++a[i];
+	}
+	return s;
+}
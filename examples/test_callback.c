@@ -0,0 +1,133 @@
+//
+// gcc -std=gnu99 -o test_callback test_callback.c -I/opt/nec/ve/veos/include -pthread -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Completion callbacks: results of asynchronous calls and memory
+// transfers are delivered to callbacks run by VEO, without host threads
+// waiting for each request. Callbacks can submit further requests with
+// callbacks, beyond the capacity of the ring of the executor.
+//
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ve_offload.h>
+
+#define NCALLS 1000
+#define NCHAIN 20000
+#define BUFSIZE 4096
+
+struct state {
+  sem_t finished;
+  int failed;
+};
+
+struct chain {
+  struct state *s;
+  uint64_t sym;
+  struct veo_args *args;
+  int remaining;/* the number of calls yet to submit */
+};
+
+static void on_call(struct veo_thr_ctxt *ctx, uint64_t reqid, int status,
+                    uint64_t retval, void *user)
+{
+  (void)ctx;
+  (void)reqid;
+  (void)retval;
+  struct state *s = user;
+  if (status != VEO_COMMAND_OK)
+    s->failed = 1;
+  sem_post(&s->finished);
+}
+
+static void on_transfer(struct veo_thr_ctxt *ctx, uint64_t reqid,
+                        int status, uint64_t retval, void *user)
+{
+  (void)ctx;
+  (void)reqid;
+  (void)retval;
+  struct state *s = user;
+  if (status != VEO_COMMAND_OK)
+    s->failed = 1;
+  sem_post(&s->finished);
+}
+
+// each completed call submits two more until NCHAIN calls in total.
+static void on_chain(struct veo_thr_ctxt *ctx, uint64_t reqid, int status,
+                     uint64_t retval, void *user)
+{
+  (void)reqid;
+  (void)retval;
+  struct chain *c = user;
+  if (status != VEO_COMMAND_OK)
+    c->s->failed = 1;
+  for (int i = 0; i < 2; ++i) {
+    if (__atomic_fetch_sub(&c->remaining, 1, __ATOMIC_RELAXED) <= 0)
+      break;
+    if (veo_call_async_cb(ctx, c->sym, c->args, on_chain, c)
+        == VEO_REQUEST_ID_INVALID) {
+      c->s->failed = 1;
+      sem_post(&c->s->finished);
+    }
+  }
+  sem_post(&c->s->finished);
+}
+
+int main()
+{
+  struct state s = { .failed = 0 };
+  sem_init(&s.finished, 0, 0);
+
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  uint64_t handle = veo_load_library(proc, "./libvebench.so");
+  uint64_t sym = veo_get_sym(proc, handle, "empty");
+  struct veo_thr_ctxt *ctx = veo_context_open(proc);
+  struct veo_args *args = veo_args_alloc();
+
+  for (int i = 0; i < NCALLS; ++i) {
+    if (veo_call_async_cb(ctx, sym, args, on_call, &s)
+        == VEO_REQUEST_ID_INVALID) {
+      printf("FAILED: veo_call_async_cb\n");
+      exit(1);
+    }
+  }
+  for (int i = 0; i < NCALLS; ++i)
+    sem_wait(&s.finished);
+  printf("%d calls completed\n", NCALLS);
+
+  struct chain c = { .s = &s, .sym = sym, .args = args,
+                     .remaining = NCHAIN - 1 };
+  veo_call_async_cb(ctx, sym, args, on_chain, &c);
+  for (int i = 0; i < NCHAIN; ++i)
+    sem_wait(&s.finished);
+  printf("%d chained calls completed\n", NCHAIN);
+
+  static char src[BUFSIZE], dst[BUFSIZE];
+  uint64_t vebuf;
+  veo_alloc_mem(proc, &vebuf, BUFSIZE);
+  memset(src, 0x5a, BUFSIZE);
+  veo_async_write_mem_cb(ctx, vebuf, src, BUFSIZE, on_transfer, &s);
+  veo_async_read_mem_cb(ctx, dst, vebuf, BUFSIZE, on_transfer, &s);
+  sem_wait(&s.finished);
+  sem_wait(&s.finished);
+  if (memcmp(src, dst, BUFSIZE) != 0) {
+    printf("FAILED: data read differs from data written\n");
+    exit(1);
+  }
+  printf("transfers completed\n");
+
+  veo_free_mem(proc, vebuf);
+  veo_args_free(args);
+  veo_context_close(ctx);
+  veo_proc_destroy(proc);
+  if (s.failed) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
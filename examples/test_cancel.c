@@ -0,0 +1,63 @@
+//
+// gcc -std=gnu99 -o test_cancel test_cancel.c -I/opt/nec/ve/veos/include -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Cancellation of queued requests: while the first call sleeps on VE,
+// the calls queued behind it are cancelled one by one and in bulk.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <ve_offload.h>
+
+#define NCALLS 8
+
+int main()
+{
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  uint64_t handle = veo_load_library(proc, "./libvesleep.so");
+  uint64_t sym = veo_get_sym(proc, handle, "do_sleep");
+  struct veo_thr_ctxt *ctx = veo_context_open(proc);
+  struct veo_args *args = veo_args_alloc();
+  uint64_t reqs[NCALLS], retval;
+  int err = 0;
+
+  veo_args_set_i32(args, 0, 1);
+  for (int i = 0; i < NCALLS; ++i)
+    reqs[i] = veo_call_async(ctx, sym, args);
+
+  // the last call is cancelled alone, the rest except the first in bulk.
+  if (veo_call_cancel(ctx, reqs[NCALLS - 1]) != 0) {
+    printf("FAILED: veo_call_cancel\n");
+    err = 1;
+  }
+  if (veo_call_cancel(ctx, reqs[NCALLS - 1]) != -1) {
+    printf("FAILED: a request was cancelled twice\n");
+    err = 1;
+  }
+  int n = veo_call_cancel_all(ctx);
+  printf("%d requests cancelled in bulk\n", n);
+
+  for (int i = 0; i < NCALLS; ++i) {
+    int status = veo_call_wait_result(ctx, reqs[i], &retval);
+    printf("request %d: status %d\n", i, status);
+    // the first call may or may not have started when cancelled.
+    if (i > 0 && status != VEO_COMMAND_CANCELLED)
+      err = 1;
+  }
+  if (n < NCALLS - 2) {
+    printf("FAILED: expected at least %d requests cancelled in bulk\n",
+           NCALLS - 2);
+    err = 1;
+  }
+
+  veo_args_free(args);
+  veo_context_close(ctx);
+  veo_proc_destroy(proc);
+  if (err)
+    return 1;
+  printf("PASSED\n");
+  return 0;
+}
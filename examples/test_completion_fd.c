@@ -0,0 +1,70 @@
+//
+// gcc -std=gnu99 -o test_completion_fd test_completion_fd.c -I/opt/nec/ve/veos/include -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Completions of requests on a VEO context watched by epoll(7) through
+// the file descriptor from veo_context_get_completion_fd().
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <ve_offload.h>
+
+#define NCALLS 100
+
+int main()
+{
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  uint64_t handle = veo_load_library(proc, "./libvebench.so");
+  uint64_t sym = veo_get_sym(proc, handle, "empty");
+  struct veo_thr_ctxt *ctx = veo_context_open(proc);
+  struct veo_args *args = veo_args_alloc();
+
+  int fd = veo_context_get_completion_fd(ctx);
+  if (fd < 0) {
+    perror("veo_context_get_completion_fd");
+    exit(1);
+  }
+  int ep = epoll_create1(0);
+  struct epoll_event ev = { .events = EPOLLIN, .data.fd = fd };
+  epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+
+  uint64_t reqs[NCALLS];
+  for (int i = 0; i < NCALLS; ++i)
+    reqs[i] = veo_call_async(ctx, sym, args);
+
+  // requests finish in order; next is the first one not picked up.
+  int next = 0, wakeups = 0;
+  while (next < NCALLS) {
+    struct epoll_event out;
+    if (epoll_wait(ep, &out, 1, -1) != 1)
+      continue;
+    ++wakeups;
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) != sizeof(count))
+      continue;
+    while (next < NCALLS) {
+      uint64_t retval;
+      int rv = veo_call_peek_result(ctx, reqs[next], &retval);
+      if (rv == VEO_COMMAND_UNFINISHED)
+        break;
+      if (rv != VEO_COMMAND_OK) {
+        printf("FAILED: request #%d returned %d\n", next, rv);
+        exit(1);
+      }
+      ++next;
+    }
+  }
+  printf("%d calls completed with %d wakeups\n", NCALLS, wakeups);
+
+  close(ep);
+  veo_args_free(args);
+  veo_context_close(ctx);
+  veo_proc_destroy(proc);
+  printf("OK\n");
+  return 0;
+}
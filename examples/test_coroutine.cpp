@@ -0,0 +1,69 @@
+//
+// g++ -std=c++20 -o test_coroutine test_coroutine.cpp -I/opt/nec/ve/veos/include -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// A transfer -> kernel -> readback chain written as a coroutine;
+// no thread blocks while the requests are in flight.
+//
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <veo_coroutine.hpp>
+
+namespace vc = veo::coroutine;
+
+// coroutine started at once and never awaited
+struct task {
+  struct promise_type {
+    task get_return_object() { return {}; }
+    std::suspend_never initial_suspend() { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+task pipeline(veo_thr_ctxt *ctx, uint64_t sym, veo_args *args,
+              uint64_t vebuf, std::promise<int> &done)
+{
+  uint64_t in = 42, out = 0;
+  auto w = co_await vc::write_mem(ctx, vebuf, &in, sizeof(in));
+  auto c = co_await vc::call(ctx, sym, args);
+  auto r = co_await vc::read_mem(ctx, &out, vebuf, sizeof(out));
+  std::printf("write %d, call %d (returned %lu), read %d\n",
+              w.status, c.status, c.retval, r.status);
+  done.set_value(w.ok() && c.ok() && r.ok() && out == in ? 0 : 1);
+}
+
+int main()
+{
+  veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == nullptr) {
+    std::perror("veo_proc_create");
+    std::exit(1);
+  }
+  uint64_t handle = veo_load_library(proc, "./libvebench.so");
+  uint64_t sym = veo_get_sym(proc, handle, "empty");
+  veo_thr_ctxt *ctx = veo_context_open(proc);
+  veo_args *args = veo_args_alloc();
+  uint64_t vebuf;
+  if (veo_alloc_mem(proc, &vebuf, sizeof(uint64_t)) != 0) {
+    std::perror("veo_alloc_mem");
+    std::exit(1);
+  }
+
+  std::promise<int> done;
+  auto result = done.get_future();
+  pipeline(ctx, sym, args, vebuf, done);
+  int err = result.get();
+
+  veo_free_mem(proc, vebuf);
+  veo_args_free(args);
+  veo_context_close(ctx);
+  veo_proc_destroy(proc);
+  if (err) {
+    std::printf("FAILED\n");
+    return 1;
+  }
+  std::printf("PASSED\n");
+  return 0;
+}
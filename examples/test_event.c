@@ -0,0 +1,97 @@
+//
+// gcc -std=gnu99 -o test_event test_event.c -I/opt/nec/ve/veos/include -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Cross-context dependency by an event: a read on context B waits for
+// a write on context A without a round trip to the host thread.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ve_offload.h>
+
+#define SIZE (16 * 1024 * 1024)
+
+static volatile int gate;
+
+static uint64_t hold(void *arg)
+{
+  (void)arg;
+  while (!gate)
+    ;
+  return 0;
+}
+
+int main()
+{
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  struct veo_thr_ctxt *a = veo_context_open(proc);
+  struct veo_thr_ctxt *b = veo_context_open(proc);
+  struct veo_event *ev = veo_event_create();
+  uint64_t vebuf, retval;
+  if (veo_alloc_mem(proc, &vebuf, SIZE) != 0) {
+    perror("veo_alloc_mem");
+    exit(1);
+  }
+  char *src = malloc(SIZE), *dst = malloc(SIZE);
+  for (int i = 0; i < SIZE; ++i)
+    src[i] = (char)i;
+  memset(dst, 0, SIZE);
+
+  // the whole pipeline is enqueued up front.
+  uint64_t wreq = veo_async_write_mem(a, vebuf, src, SIZE);
+  veo_event_record(a, ev);
+  veo_event_wait(b, ev);
+  uint64_t rreq = veo_async_read_mem(b, dst, vebuf, SIZE);
+
+  int err = 0;
+  if (veo_call_wait_result(b, rreq, &retval) != VEO_COMMAND_OK) {
+    printf("FAILED: read on context B\n");
+    err = 1;
+  }
+  if (veo_event_query(ev) != VEO_COMMAND_OK) {
+    printf("FAILED: the event is not reached\n");
+    err = 1;
+  }
+  if (memcmp(src, dst, SIZE) != 0) {
+    printf("FAILED: the read did not wait for the write\n");
+    err = 1;
+  }
+  veo_call_wait_result(a, wreq, &retval);
+
+  // the host thread can wait for an event, too.
+  veo_async_write_mem(a, vebuf, dst, SIZE);
+  veo_event_record(a, ev);
+  veo_event_synchronize(ev);
+
+  // an event cannot move to context B until its record on A is reached.
+  uint64_t hreq = veo_call_async_vh(a, hold, NULL);
+  veo_event_record(a, ev);
+  if (veo_event_record(b, ev) == 0) {
+    printf("FAILED: recorded on B while the record on A is pending\n");
+    err = 1;
+  }
+  gate = 1;
+  veo_call_wait_result(a, hreq, &retval);
+  veo_event_synchronize(ev);
+  if (veo_event_record(b, ev) != 0) {
+    printf("FAILED: record on B after the record on A is reached\n");
+    err = 1;
+  }
+  veo_event_synchronize(ev);
+
+  veo_event_destroy(ev);
+  free(src);
+  free(dst);
+  veo_free_mem(proc, vebuf);
+  veo_context_close(b);
+  veo_context_close(a);
+  veo_proc_destroy(proc);
+  if (err)
+    return 1;
+  printf("PASSED\n");
+  return 0;
+}
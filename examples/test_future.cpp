@@ -0,0 +1,79 @@
+//
+// g++ -std=c++11 -o test_future test_future.cpp -I/opt/nec/ve/veos/include -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Transfer -> kernel -> readback chains built with then() on several
+// contexts, joined by when_all() and checked by continuations returning
+// void; no thread waits per request.
+//
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <veo_future.hpp>
+
+namespace vf = veo::futures;
+
+#define NCTX 4
+
+int main()
+{
+  veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == nullptr) {
+    std::perror("veo_proc_create");
+    std::exit(1);
+  }
+  uint64_t handle = veo_load_library(proc, "./libvebench.so");
+  uint64_t sym = veo_get_sym(proc, handle, "empty");
+  veo_thr_ctxt *ctx[NCTX];
+  veo_args *args[NCTX];
+  uint64_t vebuf[NCTX], in[NCTX], out[NCTX];
+  for (int i = 0; i < NCTX; ++i) {
+    ctx[i] = veo_context_open(proc);
+    args[i] = veo_args_alloc();
+    if (veo_alloc_mem(proc, &vebuf[i], sizeof(uint64_t)) != 0) {
+      std::perror("veo_alloc_mem");
+      std::exit(1);
+    }
+    in[i] = 100 + i;
+    out[i] = 0;
+  }
+
+  std::vector<vf::future<vf::result> > chains;
+  for (int i = 0; i < NCTX; ++i) {
+    veo_thr_ctxt *c = ctx[i];
+    veo_args *a = args[i];
+    uint64_t buf = vebuf[i];
+    uint64_t *o = &out[i];
+    chains.push_back(vf::write_mem(c, buf, &in[i], sizeof(uint64_t))
+      .then([=](vf::result) { return vf::call(c, sym, a); })
+      .then([=](vf::result) { return vf::read_mem(c, o, buf, sizeof(uint64_t)); }));
+  }
+  auto first = vf::when_any(chains).get();
+  std::printf("chain %zu finished first\n", first.index);
+  int err = 0;
+  bool checked = false;
+  // continuations returning void
+  vf::future<void> done = vf::when_all(chains)
+    .then([&](const std::vector<vf::result> &rs) {
+        for (auto &r: rs)
+          if (!r.ok())
+            err = 1;
+      })
+    .then([&] { checked = true; });
+  done.get();
+  if (!checked)
+    err = 1;
+  for (int i = 0; i < NCTX; ++i) {
+    if (out[i] != in[i])
+      err = 1;
+    veo_free_mem(proc, vebuf[i]);
+    veo_args_free(args[i]);
+    veo_context_close(ctx[i]);
+  }
+  veo_proc_destroy(proc);
+  if (err) {
+    std::printf("FAILED\n");
+    return 1;
+  }
+  std::printf("PASSED\n");
+  return 0;
+}
@@ -0,0 +1,106 @@
+//
+// gcc -std=gnu99 -o test_graph_args test_graph_args.c -I/opt/nec/ve/veos/include -pthread -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Arguments of a captured call modified between launches of a graph:
+// values on register and on stack, and a buffer of another size.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ve_offload.h>
+
+#define N 1024
+
+static int launch(struct veo_thr_ctxt *ctx, struct veo_graph *g,
+                  uint64_t *retval)
+{
+	uint64_t req = veo_graph_launch(ctx, g);
+	return veo_call_wait_result(ctx, req, retval);
+}
+
+static struct veo_graph *capture(struct veo_thr_ctxt *ctx, uint64_t sym,
+                                 struct veo_args *arg)
+{
+	if (veo_graph_begin_capture(ctx) != 0) {
+		printf("veo_graph_begin_capture() failed!\n");
+		exit(1);
+	}
+	veo_call_async(ctx, sym, arg);
+	return veo_graph_end_capture(ctx);
+}
+
+int main()
+{
+	struct veo_proc_handle *proc = veo_proc_create(0);
+	if (proc == NULL) {
+		printf("veo_proc_create() failed!\n");
+		exit(1);
+	}
+	uint64_t handle = veo_load_library(proc, "./libvestackargs.so");
+	struct veo_thr_ctxt *ctx = veo_context_open(proc);
+	int err = 0;
+	int ret;
+
+	// values in the parameter area on stack
+	uint64_t sym = veo_get_sym(proc, handle, "test_many_args");
+	struct veo_args *arg = veo_args_alloc();
+	for (int i = 0; i < 10; ++i)
+		veo_args_set_double(arg, i, 1.0);
+	struct veo_graph *g = capture(ctx, sym, arg);
+	union {
+		double d;
+		uint64_t u;
+	} r;
+	ret = launch(ctx, g, &r.u);
+	if (ret != VEO_COMMAND_OK || r.d != 10.0) {
+		printf("many args #1: %d, %f\n", ret, r.d);
+		err = 1;
+	}
+	veo_args_set_double(arg, 0, 2.0);// on register
+	veo_args_set_double(arg, 9, 3.0);// on stack
+	ret = launch(ctx, g, &r.u);
+	if (ret != VEO_COMMAND_OK || r.d != 13.0) {
+		printf("many args #2: %d, %f (expected 13)\n", ret, r.d);
+		err = 1;
+	}
+	veo_graph_destroy(g);
+	veo_args_free(arg);
+
+	// INOUT buffer replaced by a larger one
+	static long a[N], b[2 * N];
+	for (long i = 0; i < N; ++i)
+		a[i] = 1;
+	for (long i = 0; i < 2 * N; ++i)
+		b[i] = 2;
+	sym = veo_get_sym(proc, handle, "test_large_inout");
+	arg = veo_args_alloc();
+	veo_args_set_stack(arg, VEO_INTENT_INOUT, 0, (char *)a, sizeof(a));
+	veo_args_set_i64(arg, 1, N);
+	g = capture(ctx, sym, arg);
+	uint64_t sum;
+	ret = launch(ctx, g, &sum);
+	if (ret != VEO_COMMAND_OK || sum != N || a[N - 1] != 2) {
+		printf("buffer #1: %d, sum = %lu, a = %ld\n", ret, sum, a[N - 1]);
+		err = 1;
+	}
+	veo_args_set_stack(arg, VEO_INTENT_INOUT, 0, (char *)b, sizeof(b));
+	veo_args_set_i64(arg, 1, 2 * N);
+	ret = launch(ctx, g, &sum);
+	if (ret != VEO_COMMAND_OK || sum != 4 * N || b[2 * N - 1] != 3
+	    || a[0] != 2) {
+		printf("buffer #2: %d, sum = %lu (expected %d), b = %ld\n", ret,
+		       sum, 4 * N, b[2 * N - 1]);
+		err = 1;
+	}
+	veo_graph_destroy(g);
+	veo_args_free(arg);
+
+	veo_context_close(ctx);
+	veo_proc_destroy(proc);
+	if (err) {
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
@@ -0,0 +1,59 @@
+//
+// gcc -std=gnu99 -o test_heap_args test_heap_args.c -I/opt/nec/ve/veos/include -pthread -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// An INOUT array larger than the stack of a context passed by
+// veo_args_set_stack(); it is placed on VE heap around the call.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <ve_offload.h>
+
+#define N (16L * 1024 * 1024)// 128 MB
+
+int main()
+{
+	struct veo_proc_handle *proc = veo_proc_create(0);
+	if (proc == NULL) {
+		printf("veo_proc_create() failed!\n");
+		exit(1);
+	}
+	uint64_t handle = veo_load_library(proc, "./libvestackargs.so");
+	uint64_t sym = veo_get_sym(proc, handle, "test_large_inout");
+	struct veo_thr_ctxt *ctx = veo_context_open(proc);
+	struct veo_args *arg = veo_args_alloc();
+	long *a = malloc(N * sizeof(long));
+	for (long i = 0; i < N; ++i)
+		a[i] = i;
+	veo_args_set_stack(arg, VEO_INTENT_INOUT, 0, (char *)a, N * sizeof(long));
+	veo_args_set_i64(arg, 1, N);
+
+	int err = 0;
+	for (int iter = 0; iter < 3; ++iter) {
+		uint64_t req = veo_call_async(ctx, sym, arg);
+		long retval;
+		int ret = veo_call_wait_result(ctx, req, (uint64_t *)&retval);
+		long expected = N * (N - 1) / 2 + iter * N;
+		printf("call %d: %d, sum = %ld (expected %ld)\n", iter, ret,
+		       retval, expected);
+		if (ret != VEO_COMMAND_OK || retval != expected)
+			err = 1;
+	}
+	for (long i = 0; i < N; ++i) {
+		if (a[i] != i + 3) {
+			printf("a[%ld] = %ld\n", i, a[i]);
+			err = 1;
+			break;
+		}
+	}
+
+	free(a);
+	veo_args_free(arg);
+	veo_context_close(ctx);
+	veo_proc_destroy(proc);
+	if (err) {
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
@@ -0,0 +1,82 @@
+//
+// gcc -std=gnu99 -o test_lane_stress test_lane_stress.c -I/opt/nec/ve/veos/include -pthread -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Threads submitting to both lanes of one context at once: the high
+// lane keeps the normal lane starved while many times more request IDs
+// than the completion slots are issued. The test fails by the alarm if
+// the context stalls.
+//
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <ve_offload.h>
+
+#define NTHREADS 8
+#define NREQS 20000
+#define WINDOW 2000
+
+struct param {
+  pthread_t thread;
+  struct veo_thr_ctxt *ctx;
+  uint64_t sym;
+  struct veo_args *args;
+  int prio;
+  int err;
+};
+
+static void *submit(void *arg)
+{
+  struct param *p = arg;
+  static __thread uint64_t reqs[WINDOW];
+  for (int i = 0; i < NREQS; i += WINDOW) {
+    for (int j = 0; j < WINDOW; ++j)
+      reqs[j] = veo_call_async_prio(p->ctx, p->sym, p->args, p->prio);
+    for (int j = 0; j < WINDOW; ++j) {
+      uint64_t retval;
+      if (veo_call_wait_result(p->ctx, reqs[j], &retval) != VEO_COMMAND_OK)
+        p->err = 1;
+    }
+  }
+  return NULL;
+}
+
+int main()
+{
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  uint64_t handle = veo_load_library(proc, "./libvebench.so");
+  uint64_t sym = veo_get_sym(proc, handle, "empty");
+  struct veo_thr_ctxt *ctx = veo_context_open(proc);
+  struct veo_args *args = veo_args_alloc();
+
+  alarm(600);
+  struct param p[NTHREADS];
+  for (int i = 0; i < NTHREADS; ++i) {
+    p[i].ctx = ctx;
+    p[i].sym = sym;
+    p[i].args = args;
+    // a quarter of the threads submit to the normal lane.
+    p[i].prio = i % 4 == 0 ? VEO_PRIO_NORMAL : VEO_PRIO_HIGH;
+    p[i].err = 0;
+    pthread_create(&p[i].thread, NULL, submit, &p[i]);
+  }
+  int err = 0;
+  for (int i = 0; i < NTHREADS; ++i) {
+    pthread_join(p[i].thread, NULL);
+    err |= p[i].err;
+  }
+
+  veo_args_free(args);
+  veo_context_close(ctx);
+  veo_proc_destroy(proc);
+  if (err) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("PASSED\n");
+  return 0;
+}
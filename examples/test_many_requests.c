@@ -0,0 +1,54 @@
+//
+// gcc -std=gnu99 -o test_many_requests test_many_requests.c -I/opt/nec/ve/veos/include -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// More requests than the completion slots of a context are submitted
+// before any result is picked up; every result is still available when
+// the requests are waited for in order.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <ve_offload.h>
+
+#define NREQS 40000
+
+static uint64_t triple(void *arg)
+{
+  return (uint64_t)(uintptr_t)arg * 3;
+}
+
+int main()
+{
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  struct veo_thr_ctxt *ctx = veo_context_open(proc);
+  static uint64_t reqs[NREQS];
+  int err = 0;
+
+  for (uintptr_t i = 0; i < NREQS; ++i) {
+    reqs[i] = veo_call_async_vh(ctx, triple, (void *)i);
+    if (reqs[i] == VEO_REQUEST_ID_INVALID) {
+      printf("FAILED: request %lu not submitted\n", (unsigned long)i);
+      exit(1);
+    }
+  }
+  for (int i = 0; i < NREQS; ++i) {
+    uint64_t retval;
+    int status = veo_call_wait_result(ctx, reqs[i], &retval);
+    if (status != VEO_COMMAND_OK || retval != (uint64_t)i * 3) {
+      printf("FAILED: request %d: status %d, retval %lu\n", i, status,
+             (unsigned long)retval);
+      err = 1;
+      break;
+    }
+  }
+
+  veo_context_close(ctx);
+  veo_proc_destroy(proc);
+  if (err)
+    return 1;
+  printf("PASSED\n");
+  return 0;
+}
@@ -0,0 +1,122 @@
+//
+// gcc -std=gnu99 -o test_packed test_packed.c -I/opt/nec/ve/veos/include -pthread -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Arguments of test_many_inout() in libvestackargs.so set at once by
+// veo_args_set_packed() from type codes and a packed value block.
+// Packing other buffers of the same lengths keeps the layout of
+// the arguments, so that a call plan writes the new values into the
+// stack laid out at its first launch.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ve_offload.h>
+
+static char *pack(char *p, const void *val, size_t size)
+{
+	memcpy(p, val, size);
+	return p + size;
+}
+
+static char *pack_stack(char *p, void *buff, size_t len)
+{
+	p = pack(p, &buff, sizeof(buff));
+	return pack(p, &len, sizeof(len));
+}
+
+int main()
+{
+	struct veo_proc_handle *proc = veo_proc_create(0);
+	if (proc == NULL) {
+		printf("veo_proc_create() failed!\n");
+		exit(1);
+	}
+	uint64_t handle = veo_load_library(proc, "./libvestackargs.so");
+	uint64_t sym = veo_get_sym(proc, handle, "test_many_inout");
+	struct veo_thr_ctxt *ctx = veo_context_open(proc);
+	struct veo_args *arg = veo_args_alloc();
+
+	char in0[] = "Hello, world.";
+	int inout1 = 42;
+	float out2 = 0;
+	char out8[16] = "";
+	uint32_t i9 = sizeof(out8);
+	uint8_t types[10] = {
+		VEO_ARG_STACK_IN, VEO_ARG_STACK_INOUT, VEO_ARG_STACK_OUT,
+		VEO_ARG_DOUBLE, VEO_ARG_DOUBLE, VEO_ARG_DOUBLE, VEO_ARG_DOUBLE,
+		VEO_ARG_DOUBLE, VEO_ARG_STACK_OUT, VEO_ARG_U32,
+	};
+	char values[128];
+	char *p = values;
+	p = pack_stack(p, in0, sizeof(in0));
+	p = pack_stack(p, &inout1, sizeof(inout1));
+	p = pack_stack(p, &out2, sizeof(out2));
+	for (int i = 1; i <= 5; ++i) {
+		double d = i;
+		p = pack(p, &d, sizeof(d));
+	}
+	p = pack_stack(p, out8, sizeof(out8));
+	p = pack(p, &i9, sizeof(i9));
+	if (veo_args_set_packed(arg, 10, types, values) != 0) {
+		printf("veo_args_set_packed() failed\n");
+		exit(1);
+	}
+
+	uint64_t retval;
+	uint64_t req = veo_call_async(ctx, sym, arg);
+	int ret = veo_call_wait_result(ctx, req, &retval);
+	printf("VH: ret = %d, retval = %lu\n", ret, retval);
+	printf("VH: inout1 = %d, out2 = %f, out8 = %s\n", inout1,
+	       (double)out2, out8);
+	int err = ret != VEO_COMMAND_OK || retval != 1 || inout1 != 43
+	          || out2 != 15.0f || strcmp(out8, "Hello, 89abcdef") != 0;
+
+	// repack with other buffers and values of the same layout.
+	struct veo_call_plan *plan = veo_call_plan_create(ctx, sym, arg);
+	if (plan == NULL) {
+		printf("veo_call_plan_create() failed\n");
+		exit(1);
+	}
+	for (int k = 0; k < 4; ++k) {
+		char in[] = "Hello, again.";
+		int inout = 100 * k;
+		float out = 0;
+		char out8b[16] = "";
+		p = values;
+		p = pack_stack(p, in, sizeof(in));
+		p = pack_stack(p, &inout, sizeof(inout));
+		p = pack_stack(p, &out, sizeof(out));
+		for (int i = 1; i <= 5; ++i) {
+			double d = i * k;
+			p = pack(p, &d, sizeof(d));
+		}
+		p = pack_stack(p, out8b, sizeof(out8b));
+		p = pack(p, &i9, sizeof(i9));
+		if (veo_args_set_packed(arg, 10, types, values) != 0) {
+			printf("veo_args_set_packed() failed\n");
+			exit(1);
+		}
+		req = veo_call_plan_launch(plan);
+		ret = veo_call_wait_result(ctx, req, &retval);
+		if (ret != VEO_COMMAND_OK || retval != 1 || inout != 100 * k + 1
+		    || out != 15.0f * k || strcmp(out8b, "Hello, 89abcdef") != 0) {
+			printf("FAILED: launch %d of the plan after repacking\n", k);
+			err = 1;
+		}
+	}
+	veo_call_plan_destroy(plan);
+
+	uint8_t bad = 0xff;
+	if (veo_args_set_packed(arg, 1, &bad, values) != -1)
+		err = 1;
+
+	veo_args_free(arg);
+	veo_context_close(ctx);
+	veo_proc_destroy(proc);
+	if (err) {
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
@@ -0,0 +1,77 @@
+//
+// gcc -std=gnu99 -o test_snapshot test_snapshot.c -I/opt/nec/ve/veos/include -pthread -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Many calls in flight fed by one veo_args in snapshot mode: the
+// arguments and the IN buffer are refilled right after each submission.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <ve_offload.h>
+
+#define N 1024
+#define NCALLS 64
+
+int main()
+{
+	struct veo_proc_handle *proc = veo_proc_create(0);
+	if (proc == NULL) {
+		printf("veo_proc_create() failed!\n");
+		exit(1);
+	}
+	uint64_t handle = veo_load_library(proc, "./libvestackargs.so");
+	uint64_t sym = veo_get_sym(proc, handle, "test_large_inout");
+	struct veo_thr_ctxt *ctx = veo_context_open(proc);
+	struct veo_args *arg = veo_args_alloc();
+	veo_args_set_snapshot(arg, 1);
+
+	// IN: one buffer refilled for every call
+	static long a[N];
+	uint64_t req[NCALLS];
+	for (int c = 0; c < NCALLS; ++c) {
+		for (long i = 0; i < N; ++i)
+			a[i] = c;
+		veo_args_set_stack(arg, VEO_INTENT_IN, 0, (char *)a, sizeof(a));
+		veo_args_set_i64(arg, 1, N);
+		req[c] = veo_call_async(ctx, sym, arg);
+	}
+	int err = 0;
+	for (int c = 0; c < NCALLS; ++c) {
+		long retval;
+		int ret = veo_call_wait_result(ctx, req[c], (uint64_t *)&retval);
+		if (ret != VEO_COMMAND_OK || retval != (long)c * N) {
+			printf("call %d: %d, sum = %ld (expected %ld)\n", c, ret,
+			       retval, (long)c * N);
+			err = 1;
+		}
+	}
+
+	// INOUT: results are written back to the buffer of each call
+	static long b[NCALLS][N];
+	for (int c = 0; c < NCALLS; ++c) {
+		for (long i = 0; i < N; ++i)
+			b[c][i] = c;
+		veo_args_set_stack(arg, VEO_INTENT_INOUT, 0, (char *)b[c],
+		                   sizeof(b[c]));
+		req[c] = veo_call_async(ctx, sym, arg);
+	}
+	for (int c = 0; c < NCALLS; ++c) {
+		long retval;
+		int ret = veo_call_wait_result(ctx, req[c], (uint64_t *)&retval);
+		if (ret != VEO_COMMAND_OK || retval != (long)c * N
+		    || b[c][0] != c + 1 || b[c][N - 1] != c + 1) {
+			printf("call %d: %d, sum = %ld, b = %ld\n", c, ret,
+			       retval, b[c][0]);
+			err = 1;
+		}
+	}
+
+	veo_args_free(arg);
+	veo_context_close(ctx);
+	veo_proc_destroy(proc);
+	if (err) {
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
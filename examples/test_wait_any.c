@@ -0,0 +1,115 @@
+//
+// gcc -std=gnu99 -o test_wait_any test_wait_any.c -I/opt/nec/ve/veos/include -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Dynamic load balancing over VEO contexts: the next chunk of work is
+// handed to whichever context finishes first, by veo_call_wait_any().
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <ve_offload.h>
+
+#define NCTX 4
+#define NCHUNKS 12
+
+int main()
+{
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  uint64_t handle = veo_load_library(proc, "./libvesleep.so");
+  uint64_t sym = veo_get_sym(proc, handle, "do_sleep");
+  struct veo_thr_ctxt *ctx[NCTX];
+  struct veo_args *args[NCTX];
+  struct veo_request reqs[NCTX];
+  int chunk[NCTX];
+  int next = 0, index, status;
+  uint64_t retval;
+
+  for (int i = 0; i < NCTX; ++i) {
+    ctx[i] = veo_context_open(proc);
+    args[i] = veo_args_alloc();
+    reqs[i].ctx = ctx[i];
+  }
+
+  // a call sleeping 1 second does not finish within 10ms.
+  veo_args_set_i32(args[0], 0, 1);
+  reqs[0].reqid = veo_call_async(ctx[0], sym, args[0]);
+  status = veo_call_wait_any(reqs, 1, 10, &index, &retval);
+  printf("wait_any with 10ms timeout returned %d\n", status);
+  if (status != VEO_COMMAND_UNFINISHED) {
+    printf("FAILED: expected VEO_COMMAND_UNFINISHED\n");
+    exit(1);
+  }
+  status = veo_call_wait_any(reqs, 1, -1, &index, &retval);
+  if (status != VEO_COMMAND_OK || index != 0 || retval != 1) {
+    printf("FAILED: wait_any returned %d, index %d, retval %lu\n",
+           status, index, retval);
+    exit(1);
+  }
+
+  // reqs[0..active) are in flight; ctxidx[] maps them to contexts.
+  int ctxidx[NCTX];
+  int active = NCTX;
+  for (int i = 0; i < NCTX; ++i) {
+    ctxidx[i] = i;
+    chunk[i] = next;
+    veo_args_set_i32(args[i], 0, next++ % 3);
+    reqs[i].reqid = veo_call_async(ctx[i], sym, args[i]);
+  }
+  while (active > 0) {
+    status = veo_call_wait_any(reqs, active, -1, &index, &retval);
+    int c = ctxidx[index];
+    if (status != VEO_COMMAND_OK) {
+      printf("FAILED: chunk %d returned status %d\n", chunk[index], status);
+      exit(1);
+    }
+    printf("chunk %d finished on context %d\n", chunk[index], c);
+    if (next < NCHUNKS) {
+      chunk[index] = next;
+      veo_args_set_i32(args[c], 0, next++ % 3);
+      reqs[index].reqid = veo_call_async(ctx[c], sym, args[c]);
+    } else {
+      // no more chunks: stop waiting for the context.
+      --active;
+      reqs[index] = reqs[active];
+      chunk[index] = chunk[active];
+      ctxidx[index] = ctxidx[active];
+    }
+  }
+
+  // wait_some picks up the results of all requests finished.
+  int st[NCTX];
+  uint64_t retvals[NCTX];
+  for (int i = 0; i < NCTX; ++i) {
+    ctxidx[i] = i;
+    reqs[i].ctx = ctx[i];
+    veo_args_set_i32(args[i], 0, i % 2);
+    reqs[i].reqid = veo_call_async(ctx[i], sym, args[i]);
+  }
+  active = NCTX;
+  while (active > 0) {
+    int n = veo_call_wait_some(reqs, active, -1, st, retvals);
+    printf("wait_some picked up %d results\n", n);
+    for (int i = active - 1; i >= 0; --i) {
+      if (st[i] == VEO_COMMAND_UNFINISHED)
+        continue;
+      if (st[i] != VEO_COMMAND_OK) {
+        printf("FAILED: context %d returned status %d\n", ctxidx[i], st[i]);
+        exit(1);
+      }
+      --active;
+      reqs[i] = reqs[active];
+      ctxidx[i] = ctxidx[active];
+    }
+  }
+
+  for (int i = 0; i < NCTX; ++i) {
+    veo_args_free(args[i]);
+    veo_context_close(ctx[i]);
+  }
+  veo_proc_destroy(proc);
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,69 @@
+//
+// gcc -std=gnu99 -o test_wait_timed test_wait_timed.c -I/opt/nec/ve/veos/include -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Bounded waits: a wait timing out returns VEO_COMMAND_UNFINISHED and
+// leaves the request to be picked up later.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ve_offload.h>
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main()
+{
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  uint64_t handle = veo_load_library(proc, "./libvesleep.so");
+  uint64_t sym = veo_get_sym(proc, handle, "do_sleep");
+  struct veo_thr_ctxt *ctx = veo_context_open(proc);
+  struct veo_args *args = veo_args_alloc();
+  uint64_t retval;
+  int err = 0;
+
+  // a call sleeping 1 second does not finish within 10ms.
+  veo_args_set_i32(args, 0, 1);
+  uint64_t req = veo_call_async(ctx, sym, args);
+  double start = now();
+  int status = veo_call_wait_result_timed(ctx, req, 10000000, &retval);
+  double elapsed = now() - start;
+  printf("wait_result_timed with 10ms timeout returned %d after %.3fms\n",
+         status, elapsed * 1e3);
+  if (status != VEO_COMMAND_UNFINISHED) {
+    printf("FAILED: expected VEO_COMMAND_UNFINISHED\n");
+    err = 1;
+  }
+
+  struct veo_request r = { ctx, req };
+  int index;
+  status = veo_call_wait_any_timed(&r, 1, 10000000, &index, &retval);
+  if (status != VEO_COMMAND_UNFINISHED) {
+    printf("FAILED: wait_any_timed returned %d\n", status);
+    err = 1;
+  }
+
+  // the request is still outstanding.
+  status = veo_call_wait_result_timed(ctx, req, 5000000000L, &retval);
+  if (status != VEO_COMMAND_OK || retval != 1) {
+    printf("FAILED: wait_result_timed returned %d, retval %lu\n",
+           status, retval);
+    err = 1;
+  }
+
+  veo_args_free(args);
+  veo_context_close(ctx);
+  veo_proc_destroy(proc);
+  if (err)
+    return 1;
+  printf("PASSED\n");
+  return 0;
+}
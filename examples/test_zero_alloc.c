@@ -0,0 +1,193 @@
+//
+// gcc -std=gnu99 -O2 -o test_zero_alloc test_zero_alloc.c -I/opt/nec/ve/veos/include -pthread -L/opt/nec/ve/veos/lib64 -Wl,-rpath=/opt/nec/ve/veos/lib64 -lveo
+//
+// Check that submitting requests and waiting for their results does not
+// allocate heap memory once the context is warmed up. The program
+// interposes malloc() and friends and counts the calls made from any
+// thread, including the pseudo thread, while requests are in flight.
+// Calls of VE functions use libvebench.so.
+//
+// usage: ./test_zero_alloc [iterations]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ve_offload.h>
+
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+extern void __libc_free(void *);
+
+static volatile int counting;
+static unsigned long nalloc;
+
+void *malloc(size_t size)
+{
+  if (counting)
+    __atomic_add_fetch(&nalloc, 1, __ATOMIC_RELAXED);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+  if (counting)
+    __atomic_add_fetch(&nalloc, 1, __ATOMIC_RELAXED);
+  return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+  if (counting)
+    __atomic_add_fetch(&nalloc, 1, __ATOMIC_RELAXED);
+  return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+  __libc_free(ptr);
+}
+
+static uint64_t nop(void *arg)
+{
+  return (uint64_t)arg;
+}
+
+#define BUFSIZE 4096
+
+static int run(struct veo_thr_ctxt *ctx, uint64_t vebuf, char *buf, int n)
+{
+  for (int i = 0; i < n; ++i) {
+    uint64_t req[3], retval;
+    req[0] = veo_async_write_mem(ctx, vebuf, buf, BUFSIZE);
+    req[1] = veo_async_read_mem(ctx, buf, vebuf, BUFSIZE);
+    req[2] = veo_call_async_vh(ctx, nop, (void *)(uintptr_t)i);
+    for (int j = 0; j < 3; ++j) {
+      if (req[j] == VEO_REQUEST_ID_INVALID) {
+        printf("request %d of iteration %d failed\n", j, i);
+        return -1;
+      }
+      if (veo_call_wait_result(ctx, req[j], &retval) != VEO_COMMAND_OK) {
+        printf("request %d of iteration %d did not complete\n", j, i);
+        return -1;
+      }
+    }
+    if (retval != (uint64_t)i) {
+      printf("unexpected return value %lu (expected %d)\n", retval, i);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static int run_calls(struct veo_thr_ctxt *ctx, uint64_t sym,
+                     struct veo_args *args, int n)
+{
+  for (int i = 0; i < n; ++i) {
+    uint64_t retval;
+    uint64_t req = veo_call_async(ctx, sym, args);
+    if (req == VEO_REQUEST_ID_INVALID) {
+      printf("call of iteration %d failed\n", i);
+      return -1;
+    }
+    if (veo_call_wait_result(ctx, req, &retval) != VEO_COMMAND_OK) {
+      printf("call of iteration %d did not complete\n", i);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// arguments are set again on each call, of all scalar types on register.
+static int run_scalar_calls(struct veo_thr_ctxt *ctx, uint64_t sym,
+                            struct veo_args *args, int n)
+{
+  for (int i = 0; i < n; ++i) {
+    uint64_t retval;
+    veo_args_clear(args);
+    veo_args_set_i64(args, 0, i);
+    veo_args_set_u64(args, 1, 1);
+    veo_args_set_i32(args, 2, 2);
+    veo_args_set_u32(args, 3, 3);
+    veo_args_set_i16(args, 4, 4);
+    veo_args_set_u16(args, 5, 5);
+    veo_args_set_i8(args, 6, 6);
+    veo_args_set_u8(args, 7, 7);
+    uint64_t req = veo_call_async(ctx, sym, args);
+    if (req == VEO_REQUEST_ID_INVALID) {
+      printf("call with scalars of iteration %d failed\n", i);
+      return -1;
+    }
+    if (veo_call_wait_result(ctx, req, &retval) != VEO_COMMAND_OK) {
+      printf("call with scalars of iteration %d did not complete\n", i);
+      return -1;
+    }
+    if (retval != (uint64_t)i + 28) {
+      printf("unexpected return value %lu (expected %d)\n", retval, i + 28);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+  static char buf[BUFSIZE];
+
+  struct veo_proc_handle *proc = veo_proc_create(0);
+  if (proc == NULL) {
+    perror("veo_proc_create");
+    exit(1);
+  }
+  struct veo_thr_ctxt *ctx = veo_context_open(proc);
+  if (ctx == NULL) {
+    perror("veo_context_open");
+    exit(1);
+  }
+  uint64_t handle = veo_load_library(proc, "./libvebench.so");
+  uint64_t sym = veo_get_sym(proc, handle, "empty");
+  if (sym == 0) {
+    printf("empty() is not found in libvebench.so\n");
+    exit(1);
+  }
+  uint64_t sym8 = veo_get_sym(proc, handle, "sum8");
+  if (sym8 == 0) {
+    printf("sum8() is not found in libvebench.so\n");
+    exit(1);
+  }
+  struct veo_args *args = veo_args_alloc();
+  struct veo_args *args8 = veo_args_alloc();
+  uint64_t vebuf;
+  if (veo_alloc_mem(proc, &vebuf, BUFSIZE) != 0) {
+    perror("veo_alloc_mem");
+    exit(1);
+  }
+  memset(buf, 0x5a, sizeof(buf));
+
+  // warm up: let the library and libc finish their lazy initialization.
+  if (run(ctx, vebuf, buf, 100) != 0 || run_calls(ctx, sym, args, 100) != 0
+      || run_scalar_calls(ctx, sym8, args8, 100) != 0)
+    exit(1);
+
+  counting = 1;
+  int rv = run(ctx, vebuf, buf, iterations);
+  if (rv == 0)
+    rv = run_calls(ctx, sym, args, iterations);
+  if (rv == 0)
+    rv = run_scalar_calls(ctx, sym8, args8, iterations);
+  counting = 0;
+
+  printf("%d iterations: %lu allocations\n", iterations, nalloc);
+  veo_free_mem(proc, vebuf);
+  veo_args_free(args8);
+  veo_args_free(args);
+  veo_context_close(ctx);
+  veo_proc_destroy(proc);
+  if (rv != 0 || nalloc != 0) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
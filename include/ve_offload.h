@@ -24,7 +24,7 @@
 #ifndef _VE_OFFLOAD_H_
 #define _VE_OFFLOAD_H_
 
-#define VEO_API_VERSION 8
+#define VEO_API_VERSION 9
 #define VEO_SYMNAME_LEN_MAX (255)
 #define VEO_LOG_CATEGORY "veos.veo.veo"
 #define VEO_MAX_NUM_ARGS (32)
@@ -50,6 +50,7 @@ enum veo_command_state {
   VEO_COMMAND_EXCEPTION,
   VEO_COMMAND_ERROR,
   VEO_COMMAND_UNFINISHED,
+  VEO_COMMAND_CANCELLED,
 };
 
 enum veo_args_intent {
@@ -63,10 +64,66 @@ enum veo_queue_state {
   VEO_QUEUE_CLOSED,
 };
 
+enum veo_request_priority {
+  VEO_PRIO_NORMAL = 0,
+  VEO_PRIO_HIGH,
+};
+
+enum veo_wait_policy {
+  VEO_WAIT_PARK = 0,
+  VEO_WAIT_SPIN,
+  VEO_WAIT_ADAPTIVE,
+};
+
+/**
+ * @brief type code of an argument set by veo_args_set_packed()
+ *
+ * A scalar takes its own size in the packed value block; an argument on
+ * stack takes a pointer to the buffer followed by its size_t length.
+ */
+enum veo_arg_type {
+  VEO_ARG_I64 = 0,
+  VEO_ARG_U64,
+  VEO_ARG_I32,
+  VEO_ARG_U32,
+  VEO_ARG_I16,
+  VEO_ARG_U16,
+  VEO_ARG_I8,
+  VEO_ARG_U8,
+  VEO_ARG_DOUBLE,
+  VEO_ARG_FLOAT,
+  VEO_ARG_STACK_IN,
+  VEO_ARG_STACK_INOUT,
+  VEO_ARG_STACK_OUT,
+};
+
 struct veo_args;
 struct veo_proc_handle;
 struct veo_thr_ctxt;
 struct veo_thr_ctxt_attr;
+struct veo_event;
+struct veo_graph;
+struct veo_call_plan;
+
+/**
+ * @brief request on a VEO context
+ *
+ * Passed to veo_call_wait_any() and veo_call_wait_some(), which report
+ * a cancelled request as VEO_COMMAND_CANCELLED.
+ */
+struct veo_request {
+  struct veo_thr_ctxt *ctx;
+  uint64_t reqid;
+};
+
+/**
+ * @brief callback on completion of a request
+ *
+ * Arguments are the context, the request ID, the status (enum
+ * veo_command_state), the return value and the user pointer.
+ */
+typedef void (*veo_completion_cb)(struct veo_thr_ctxt *, uint64_t, int,
+                                  uint64_t, void *);
 
 struct veo_proc_handle *veo_proc_create(int);
 struct veo_proc_handle *veo_proc_create_static(int, const char *);
@@ -79,10 +136,13 @@ uint64_t veo_get_sym(struct veo_proc_handle *, uint64_t, const char *);
 struct veo_thr_ctxt *veo_context_open(struct veo_proc_handle *);
 int veo_context_close(struct veo_thr_ctxt *);
 int veo_get_context_state(struct veo_thr_ctxt *);
+int veo_context_get_completion_fd(struct veo_thr_ctxt *);
 struct veo_thr_ctxt *veo_context_open_with_attr(struct veo_proc_handle *, struct veo_thr_ctxt_attr *);
 struct veo_thr_ctxt_attr *veo_alloc_thr_ctxt_attr();
 int veo_set_thr_ctxt_stacksize(struct veo_thr_ctxt_attr *, size_t);
 int veo_get_thr_ctxt_stacksize(struct veo_thr_ctxt_attr *, size_t *);
+int veo_set_thr_ctxt_wait_policy(struct veo_thr_ctxt_attr *, int);
+int veo_get_thr_ctxt_wait_policy(struct veo_thr_ctxt_attr *, int *);
 int veo_free_thr_ctxt_attr(struct veo_thr_ctxt_attr *);
 
 struct veo_args *veo_args_alloc(void);
@@ -98,14 +158,49 @@ int veo_args_set_double(struct veo_args *, int, double);
 int veo_args_set_float(struct veo_args *, int, float);
 int veo_args_set_stack(struct veo_args *, enum veo_args_intent,
                        int, char *, size_t);
+int veo_args_set_packed(struct veo_args *, int, const uint8_t *,
+                        const void *);
+int veo_args_set_snapshot(struct veo_args *, int);
 void veo_args_clear(struct veo_args *);
 void veo_args_free(struct veo_args *);
 
 uint64_t veo_call_async(struct veo_thr_ctxt *, uint64_t, struct veo_args *);
 uint64_t veo_call_async_by_name(struct veo_thr_ctxt *, uint64_t, const char *, struct veo_args *);
+int veo_call_async_batch(struct veo_thr_ctxt *, int, const uint64_t *,
+                         struct veo_args *const *, uint64_t *);
+uint64_t veo_call_async_cb(struct veo_thr_ctxt *, uint64_t, struct veo_args *,
+                           veo_completion_cb, void *);
+uint64_t veo_call_async_prio(struct veo_thr_ctxt *, uint64_t,
+                             struct veo_args *, int);
 uint64_t veo_call_async_vh(struct veo_thr_ctxt *, uint64_t (*)(void *), void *);
 int veo_call_peek_result(struct veo_thr_ctxt *, uint64_t, uint64_t *);
 int veo_call_wait_result(struct veo_thr_ctxt *, uint64_t, uint64_t *);
+int veo_call_wait_result_timed(struct veo_thr_ctxt *, uint64_t, int64_t,
+                               uint64_t *);
+int veo_call_cancel(struct veo_thr_ctxt *, uint64_t);
+int veo_call_cancel_all(struct veo_thr_ctxt *);
+int veo_call_wait_any(const struct veo_request *, int, int, int *,
+                      uint64_t *);
+int veo_call_wait_some(const struct veo_request *, int, int, int *,
+                       uint64_t *);
+int veo_call_wait_any_timed(const struct veo_request *, int, int64_t, int *,
+                            uint64_t *);
+int veo_call_wait_some_timed(const struct veo_request *, int, int64_t, int *,
+                             uint64_t *);
+struct veo_event *veo_event_create(void);
+int veo_event_destroy(struct veo_event *);
+int veo_event_record(struct veo_thr_ctxt *, struct veo_event *);
+int veo_event_wait(struct veo_thr_ctxt *, struct veo_event *);
+int veo_event_synchronize(struct veo_event *);
+int veo_event_query(struct veo_event *);
+int veo_graph_begin_capture(struct veo_thr_ctxt *);
+struct veo_graph *veo_graph_end_capture(struct veo_thr_ctxt *);
+uint64_t veo_graph_launch(struct veo_thr_ctxt *, struct veo_graph *);
+int veo_graph_destroy(struct veo_graph *);
+struct veo_call_plan *veo_call_plan_create(struct veo_thr_ctxt *, uint64_t,
+                                           struct veo_args *);
+uint64_t veo_call_plan_launch(struct veo_call_plan *);
+int veo_call_plan_destroy(struct veo_call_plan *);
 int veo_alloc_mem(struct veo_proc_handle *, uint64_t *, const size_t);
 int veo_free_mem(struct veo_proc_handle *, uint64_t);
 int veo_read_mem(struct veo_proc_handle *, void *, uint64_t, size_t);
@@ -113,6 +208,19 @@ int veo_write_mem(struct veo_proc_handle *, uint64_t, const void *, size_t);
 uint64_t veo_async_read_mem(struct veo_thr_ctxt *, void *, uint64_t, size_t);
 uint64_t veo_async_write_mem(struct veo_thr_ctxt *, uint64_t, const void *,
                              size_t);
+uint64_t veo_async_read_mem_cb(struct veo_thr_ctxt *, void *, uint64_t,
+                               size_t, veo_completion_cb, void *);
+uint64_t veo_async_write_mem_cb(struct veo_thr_ctxt *, uint64_t, const void *,
+                                size_t, veo_completion_cb, void *);
+uint64_t veo_async_read_mem_prio(struct veo_thr_ctxt *, void *, uint64_t,
+                                 size_t, int);
+uint64_t veo_async_write_mem_prio(struct veo_thr_ctxt *, uint64_t,
+                                  const void *, size_t, int);
+int veo_async_read_mem_batch(struct veo_thr_ctxt *, int, void *const *,
+                             const uint64_t *, const size_t *, uint64_t *);
+int veo_async_write_mem_batch(struct veo_thr_ctxt *, int, const uint64_t *,
+                              const void *const *, const size_t *,
+                              uint64_t *);
 
 const char *veo_version_string(void);
 int veo_api_version(void);
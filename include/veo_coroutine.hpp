@@ -0,0 +1,126 @@
+/**
+ * @file veo_coroutine.hpp
+ * @brief C++20 coroutine support for VEO requests
+ *
+ * Function calls and memory transfers return awaitable objects.
+ * A coroutine awaiting one is suspended without blocking a thread and
+ * resumed on the completion executor of the process when the request
+ * finishes, by the callback of the request.
+ *
+ * @code
+ * veo::coroutine::result r = co_await veo::coroutine::call(ctx, addr, args);
+ * if (r.status == VEO_COMMAND_OK)
+ *   use(r.retval);
+ * @endcode
+ *
+ * The coroutine runs on the completion executor after it is resumed,
+ * so that it must not block there, e.g. by veo_call_wait_result() for
+ * a request with a callback, until it awaits again or finishes.
+ */
+#ifndef _VEO_COROUTINE_HPP_
+#define _VEO_COROUTINE_HPP_
+#if __cplusplus < 202002L
+#error "veo_coroutine.hpp requires C++20"
+#endif
+#include <coroutine>
+#include <ve_offload.h>
+
+namespace veo {
+namespace coroutine {
+/**
+ * @brief result of a request
+ */
+struct result {
+  int status;//!< status of the request (enum veo_command_state)
+  uint64_t retval;//!< return value
+  bool ok() const noexcept { return this->status == VEO_COMMAND_OK; }
+};
+
+/**
+ * @brief awaitable of a request submitted on suspension
+ *
+ * @tparam Submit function submitting the request with a callback:
+ *         submit(cb, user) returning the request ID.
+ *
+ * The request is submitted after the coroutine is suspended, so that
+ * its completion can resume the coroutine at once, even before
+ * await_suspend() returns. If the submission fails, the coroutine
+ * continues without suspension with VEO_COMMAND_ERROR.
+ */
+template <typename Submit> class awaiter {
+  Submit submit_;
+  std::coroutine_handle<> handle_;
+  result result_;
+
+  static void on_complete(veo_thr_ctxt *, uint64_t, int status,
+                          uint64_t retval, void *user) {
+    auto self = static_cast<awaiter *>(user);
+    self->result_ = result{status, retval};
+    self->handle_.resume();
+  }
+public:
+  explicit awaiter(Submit submit): submit_(submit),
+    result_{VEO_COMMAND_UNFINISHED, 0} {}
+  bool await_ready() const noexcept { return false; }
+  bool await_suspend(std::coroutine_handle<> h) noexcept {
+    this->handle_ = h;
+    // the frame holding this awaiter can be resumed and destroyed by
+    // the callback once submitted; do not touch members after that.
+    auto submit = this->submit_;
+    if (submit(&awaiter::on_complete, this) == VEO_REQUEST_ID_INVALID) {
+      this->result_ = result{VEO_COMMAND_ERROR, 0};
+      return false;
+    }
+    return true;
+  }
+  result await_resume() const noexcept { return this->result_; }
+};
+
+/**
+ * @brief call a VE function
+ * @param ctx VEO context
+ * @param addr VEMVA of the function
+ * @param args arguments; must be kept until the call finishes.
+ * @return awaitable resulting in the status and the return value
+ */
+inline auto call(veo_thr_ctxt *ctx, uint64_t addr, veo_args *args)
+{
+  return awaiter([=](veo_completion_cb cb, void *user) {
+    return veo_call_async_cb(ctx, addr, args, cb, user);
+  });
+}
+
+/**
+ * @brief read VE memory
+ * @param ctx VEO context
+ * @param dst buffer to store data
+ * @param src VEMVA to read
+ * @param size size in bytes
+ * @return awaitable resulting in the status of the transfer
+ */
+inline auto read_mem(veo_thr_ctxt *ctx, void *dst, uint64_t src,
+                     size_t size)
+{
+  return awaiter([=](veo_completion_cb cb, void *user) {
+    return veo_async_read_mem_cb(ctx, dst, src, size, cb, user);
+  });
+}
+
+/**
+ * @brief write VE memory
+ * @param ctx VEO context
+ * @param dst VEMVA to write
+ * @param src source buffer; must be kept until the transfer finishes.
+ * @param size size in bytes
+ * @return awaitable resulting in the status of the transfer
+ */
+inline auto write_mem(veo_thr_ctxt *ctx, uint64_t dst, const void *src,
+                      size_t size)
+{
+  return awaiter([=](veo_completion_cb cb, void *user) {
+    return veo_async_write_mem_cb(ctx, dst, src, size, cb, user);
+  });
+}
+} // namespace coroutine
+} // namespace veo
+#endif
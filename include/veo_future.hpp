@@ -0,0 +1,396 @@
+/**
+ * @file veo_future.hpp
+ * @brief futures of VEO requests with continuations
+ *
+ * Function calls and memory transfers return futures fulfilled by
+ * the callbacks of the requests on the completion executor of
+ * the process. Continuations attached by then() run there as soon as
+ * the request finishes, and when_all() and when_any() combine futures
+ * by counting completions; no thread is spawned or blocked per wait.
+ *
+ * @code
+ * namespace vf = veo::futures;
+ * auto out = vf::write_mem(ctx, vebuf, in, size)
+ *   .then([=](vf::result) { return vf::call(ctx, addr, args); })
+ *   .then([=](vf::result) { return vf::read_mem(ctx, out, vebuf, size); });
+ * out.get();
+ * @endcode
+ *
+ * Continuations run on the completion executor; they must not wait for
+ * another future of a request there, e.g. by get().
+ */
+#ifndef _VEO_FUTURE_HPP_
+#define _VEO_FUTURE_HPP_
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <ve_offload.h>
+
+namespace veo {
+namespace futures {
+/**
+ * @brief result of a request
+ */
+struct result {
+  int status;//!< status of the request (enum veo_command_state)
+  uint64_t retval;//!< return value
+  bool ok() const { return this->status == VEO_COMMAND_OK; }
+};
+
+template <typename T> class future;
+template <typename T> class promise;
+
+namespace detail {
+// value stored for future<void>
+struct unit {};
+template <typename T> struct value_of { typedef T type; };
+template <> struct value_of<void> { typedef unit type; };
+
+/**
+ * @brief state shared by a promise and its futures
+ *
+ * The value is immutable once set, so that continuations read it
+ * without the lock.
+ */
+template <typename T> class shared_state {
+  typedef typename value_of<T>::type V;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  bool ready_;
+  V value_;
+  std::vector<std::function<void(const V &)> > continuations_;
+public:
+  shared_state(): ready_(false), value_() {}
+  void set(const V &v) {
+    std::vector<std::function<void(const V &)> > conts;
+    {
+      std::lock_guard<std::mutex> lock(this->mtx_);
+      if (this->ready_)
+        return;// already satisfied
+      this->value_ = v;
+      this->ready_ = true;
+      conts.swap(this->continuations_);
+    }
+    this->cv_.notify_all();
+    for (auto &c: conts)
+      c(this->value_);
+  }
+  void subscribe(std::function<void(const V &)> f) {
+    {
+      std::lock_guard<std::mutex> lock(this->mtx_);
+      if (!this->ready_) {
+        this->continuations_.push_back(std::move(f));
+        return;
+      }
+    }
+    f(this->value_);
+  }
+  bool ready() {
+    std::lock_guard<std::mutex> lock(this->mtx_);
+    return this->ready_;
+  }
+  const V &wait() {
+    std::unique_lock<std::mutex> lock(this->mtx_);
+    this->cv_.wait(lock, [this] { return this->ready_; });
+    return this->value_;
+  }
+  template <typename Rep, typename Period>
+  bool wait_for(const std::chrono::duration<Rep, Period> &d) {
+    std::unique_lock<std::mutex> lock(this->mtx_);
+    return this->cv_.wait_for(lock, d, [this] { return this->ready_; });
+  }
+};
+
+// type of the value of the future returned by then(): future<U> is
+// flattened to U.
+template <typename R> struct unwrap { typedef R type; };
+template <typename U> struct unwrap<future<U> > { typedef U type; };
+
+// fulfill a promise with the value returned by a continuation
+template <typename U, typename R> struct fulfill;
+} // namespace detail
+
+/**
+ * @brief promise to fulfill futures
+ *
+ * Copies of a promise share the state; the first value set wins.
+ */
+template <typename T> class promise {
+  std::shared_ptr<detail::shared_state<T> > st_;
+public:
+  promise(): st_(std::make_shared<detail::shared_state<T> >()) {}
+  void set_value(const T &v) { this->st_->set(v); }
+  future<T> get_future() const { return future<T>(this->st_); }
+};
+
+/**
+ * @brief future of a value
+ *
+ * Unlike std::future, a future can be copied and waited for repeatedly.
+ */
+template <typename T> class future {
+  friend class promise<T>;
+  std::shared_ptr<detail::shared_state<T> > st_;
+  explicit future(std::shared_ptr<detail::shared_state<T> > st): st_(st) {}
+public:
+  future() {}
+  bool valid() const { return this->st_ != nullptr; }
+  bool is_ready() const { return this->st_->ready(); }
+  /**
+   * @brief wait for the value
+   */
+  T get() const { return this->st_->wait(); }
+  void wait() const { this->st_->wait(); }
+  template <typename Rep, typename Period>
+  bool wait_for(const std::chrono::duration<Rep, Period> &d) const {
+    return this->st_->wait_for(d);
+  }
+  /**
+   * @brief invoke a function with the value when it is set
+   * @param f function invoked on the thread setting the value, or
+   *        at once on the calling thread if the value is already set.
+   */
+  void on_ready(std::function<void(const T &)> f) const {
+    this->st_->subscribe(std::move(f));
+  }
+  /**
+   * @brief chain a continuation
+   * @param f function taking the value and returning a value, a future
+   *        or void
+   * @return future of the value returned by f; if f returns a future,
+   *         the future of its value; future<void> if f returns void.
+   */
+  template <typename F>
+  auto then(F f) const -> future<typename detail::unwrap<
+    decltype(f(std::declval<const T &>()))>::type> {
+    typedef decltype(f(std::declval<const T &>())) R;
+    typedef typename detail::unwrap<R>::type U;
+    promise<U> p;
+    auto fut = p.get_future();
+    this->on_ready([p, f](const T &v) mutable {
+      detail::fulfill<U, R>::run(p, f, v);
+    });
+    return fut;
+  }
+};
+
+/**
+ * @brief future of completion without a value
+ *
+ * Returned by then() with a continuation returning void.
+ */
+template <> class future<void> {
+  friend class promise<void>;
+  std::shared_ptr<detail::shared_state<void> > st_;
+  explicit future(std::shared_ptr<detail::shared_state<void> > st): st_(st) {}
+public:
+  future() {}
+  bool valid() const { return this->st_ != nullptr; }
+  bool is_ready() const { return this->st_->ready(); }
+  void get() const { this->st_->wait(); }
+  void wait() const { this->st_->wait(); }
+  template <typename Rep, typename Period>
+  bool wait_for(const std::chrono::duration<Rep, Period> &d) const {
+    return this->st_->wait_for(d);
+  }
+  void on_ready(std::function<void()> f) const {
+    this->st_->subscribe([f](const detail::unit &) { f(); });
+  }
+  /**
+   * @brief chain a continuation
+   * @param f function taking no argument and returning a value or
+   *        a future
+   * @return future of the value returned by f; if f returns a future,
+   *         the future of its value.
+   */
+  template <typename F>
+  auto then(F f) const -> future<typename detail::unwrap<
+    decltype(f())>::type> {
+    typedef decltype(f()) R;
+    typedef typename detail::unwrap<R>::type U;
+    promise<U> p;
+    auto fut = p.get_future();
+    this->on_ready([p, f]() mutable { detail::fulfill<U, R>::run(p, f); });
+    return fut;
+  }
+};
+
+/**
+ * @brief promise to fulfill futures without a value
+ */
+template <> class promise<void> {
+  std::shared_ptr<detail::shared_state<void> > st_;
+public:
+  promise(): st_(std::make_shared<detail::shared_state<void> >()) {}
+  void set_value() { this->st_->set(detail::unit()); }
+  future<void> get_future() const { return future<void>(this->st_); }
+};
+
+namespace detail {
+template <typename U, typename R> struct fulfill {
+  template <typename F, typename... A>
+  static void run(promise<U> &p, F &f, const A &... a) {
+    p.set_value(f(a...));
+  }
+};
+template <> struct fulfill<void, void> {
+  template <typename F, typename... A>
+  static void run(promise<void> &p, F &f, const A &... a) {
+    f(a...);
+    p.set_value();
+  }
+};
+template <typename U> struct fulfill<U, future<U> > {
+  template <typename F, typename... A>
+  static void run(promise<U> &p, F &f, const A &... a) {
+    f(a...).on_ready([p](const U &u) mutable { p.set_value(u); });
+  }
+};
+template <> struct fulfill<void, future<void> > {
+  template <typename F, typename... A>
+  static void run(promise<void> &p, F &f, const A &... a) {
+    f(a...).on_ready([p]() mutable { p.set_value(); });
+  }
+};
+} // namespace detail
+
+namespace detail {
+// callback of a request fulfilling the promise passed as user data
+inline void on_complete(veo_thr_ctxt *, uint64_t, int status,
+                        uint64_t retval, void *user)
+{
+  std::unique_ptr<promise<result> > p(static_cast<promise<result> *>(user));
+  p->set_value(result{status, retval});
+}
+
+template <typename Submit> future<result> submit(Submit s)
+{
+  std::unique_ptr<promise<result> > p(new promise<result>());
+  auto fut = p->get_future();
+  if (s(&on_complete, p.get()) == VEO_REQUEST_ID_INVALID) {
+    p->set_value(result{VEO_COMMAND_ERROR, 0});
+    return fut;
+  }
+  p.release();// deleted by on_complete()
+  return fut;
+}
+} // namespace detail
+
+/**
+ * @brief call a VE function
+ * @param ctx VEO context
+ * @param addr VEMVA of the function
+ * @param args arguments; must be kept until the call finishes.
+ * @return future of the status and the return value;
+ *         VEO_COMMAND_ERROR if the request cannot be submitted.
+ */
+inline future<result> call(veo_thr_ctxt *ctx, uint64_t addr, veo_args *args)
+{
+  return detail::submit([=](veo_completion_cb cb, void *user) {
+    return veo_call_async_cb(ctx, addr, args, cb, user);
+  });
+}
+
+/**
+ * @brief read VE memory
+ * @param ctx VEO context
+ * @param dst buffer to store data
+ * @param src VEMVA to read
+ * @param size size in bytes
+ * @return future of the status of the transfer
+ */
+inline future<result> read_mem(veo_thr_ctxt *ctx, void *dst, uint64_t src,
+                               size_t size)
+{
+  return detail::submit([=](veo_completion_cb cb, void *user) {
+    return veo_async_read_mem_cb(ctx, dst, src, size, cb, user);
+  });
+}
+
+/**
+ * @brief write VE memory
+ * @param ctx VEO context
+ * @param dst VEMVA to write
+ * @param src source buffer; must be kept until the transfer finishes.
+ * @param size size in bytes
+ * @return future of the status of the transfer
+ */
+inline future<result> write_mem(veo_thr_ctxt *ctx, uint64_t dst,
+                                const void *src, size_t size)
+{
+  return detail::submit([=](veo_completion_cb cb, void *user) {
+    return veo_async_write_mem_cb(ctx, dst, src, size, cb, user);
+  });
+}
+
+/**
+ * @brief future of all of futures
+ * @param fs futures
+ * @return future of the values in the order of fs, set when the last
+ *         of fs is set.
+ */
+template <typename T>
+future<std::vector<T> > when_all(const std::vector<future<T> > &fs)
+{
+  struct state {
+    promise<std::vector<T> > p;
+    std::vector<T> values;
+    std::atomic<size_t> left;
+    explicit state(size_t n): values(n), left(n) {}
+  };
+  auto st = std::make_shared<state>(fs.size());
+  auto fut = st->p.get_future();
+  if (fs.empty()) {
+    st->p.set_value(st->values);
+    return fut;
+  }
+  for (size_t i = 0; i < fs.size(); ++i) {
+    fs[i].on_ready([st, i](const T &v) {
+      st->values[i] = v;
+      // the last one sees all values stored before its decrement.
+      if (st->left.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        st->p.set_value(st->values);
+    });
+  }
+  return fut;
+}
+
+/**
+ * @brief value of the first future set among futures
+ */
+template <typename T> struct when_any_result {
+  size_t index;//!< index of the future; fs.size() if fs is empty.
+  T value;//!< value of the future
+};
+
+/**
+ * @brief future of any of futures
+ * @param fs futures
+ * @return future of the index and the value of the first of fs set
+ */
+template <typename T>
+future<when_any_result<T> > when_any(const std::vector<future<T> > &fs)
+{
+  promise<when_any_result<T> > p;
+  auto fut = p.get_future();
+  if (fs.empty()) {
+    p.set_value(when_any_result<T>{0, T()});
+    return fut;
+  }
+  // the promise ignores values set after the first one.
+  for (size_t i = 0; i < fs.size(); ++i) {
+    fs[i].on_ready([p, i](const T &v) mutable {
+      p.set_value(when_any_result<T>{i, v});
+    });
+  }
+  return fut;
+}
+} // namespace futures
+} // namespace veo
+#endif
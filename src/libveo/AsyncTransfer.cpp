@@ -4,49 +4,115 @@
  */
 #include "ProcHandle.hpp"
 #include "ThreadContext.hpp"
-#include "CommandImpl.hpp"
 
 namespace veo {
+/**
+ * @brief function to be set to read request (command)
+ */
+int ThreadContext::_readMemCommandHandler(Command *cmd)
+{
+  auto rv = this->_readMem(cmd->param.read.dst, cmd->param.read.src,
+                           cmd->param.read.size);
+  cmd->setResult(rv, rv == 0 ? VEO_COMMAND_OK : VEO_COMMAND_ERROR);
+  return rv;
+}
+
+/**
+ * @brief function to be set to write request (command)
+ */
+int ThreadContext::_writeMemCommandHandler(Command *cmd)
+{
+  auto rv = this->_writeMem(cmd->param.write.dst, cmd->param.write.src,
+                            cmd->param.write.size);
+  cmd->setResult(rv, rv == 0 ? VEO_COMMAND_OK : VEO_COMMAND_ERROR);
+  return rv;
+}
+
 /**
  * @brief asynchronously read data from VE memory
  *
  * @param[out] dst buffer to store data
  * @param src VEMVA to read
  * @param size size to transfer in byte
+ * @param cb callback on completion; nullptr if not used.
+ * @param user pointer passed to the callback
+ * @param prio priority of the request (enum veo_request_priority)
  * @return request ID
  */
-uint64_t ThreadContext::asyncReadMem(void *dst, uint64_t src, size_t size)
+uint64_t ThreadContext::asyncReadMem(void *dst, uint64_t src, size_t size,
+                                     veo_completion_cb cb, void *user,
+                                     int prio)
 {
-  if( this->state == VEO_STATE_EXIT )
+  if( this->state == VEO_STATE_EXIT || !validPriority(prio) )
     return VEO_REQUEST_ID_INVALID;
 
-  auto id = this->issueRequestID();
-  auto f = [this, dst, src, size] (Command *cmd) {
-    auto rv = this->_readMem(dst, src, size);
-    cmd->setResult(rv, rv == 0 ? VEO_COMMAND_OK : VEO_COMMAND_ERROR);
-    return rv;
-  };
-  std::unique_ptr<Command> req(new internal::CommandImpl(id, f));
-  if(this->comq.pushRequest(std::move(req)))
-    return VEO_REQUEST_ID_INVALID;
-  return id;
+  return this->_submit(cb, user, prio, [=](Command *req) {
+    req->setReadMem(dst, src, size);
+  });
 }
 
+/**
+ * @brief asynchronously write data to VE memory
+ *
+ * @param dst VEMVA to write
+ * @param src source buffer
+ * @param size size to transfer in byte
+ * @param cb callback on completion; nullptr if not used.
+ * @param user pointer passed to the callback
+ * @param prio priority of the request (enum veo_request_priority)
+ * @return request ID
+ */
 uint64_t ThreadContext::asyncWriteMem(uint64_t dst, const void *src,
-                                      size_t size)
+                                      size_t size, veo_completion_cb cb,
+                                      void *user, int prio)
 {
-  if( this->state == VEO_STATE_EXIT )
+  if( this->state == VEO_STATE_EXIT || !validPriority(prio) )
     return VEO_REQUEST_ID_INVALID;
 
-  auto id = this->issueRequestID();
-  auto f = [this, dst, src, size] (Command *cmd) {
-    auto rv = this->_writeMem(dst, src, size);
-    cmd->setResult(rv, rv == 0 ? VEO_COMMAND_OK : VEO_COMMAND_ERROR);
-    return rv;
-  };
-  std::unique_ptr<Command> req(new internal::CommandImpl(id, f));
-  if(this->comq.pushRequest(std::move(req)))
-    return VEO_REQUEST_ID_INVALID;
-  return id;
+  return this->_submit(cb, user, prio, [=](Command *req) {
+    req->setWriteMem(dst, src, size);
+  });
+}
+
+/**
+ * @brief asynchronously read data from VE memory in a batch
+ *
+ * @param n the number of transfers
+ * @param[out] dst array of buffers to store data
+ * @param src array of VEMVAs to read
+ * @param size array of sizes to transfer in byte
+ * @param[out] ids array to store request IDs
+ * @return the number of requests submitted; -1 upon invalid arguments.
+ */
+int ThreadContext::asyncReadMemBatch(int n, void *const *dst,
+                                     const uint64_t *src, const size_t *size,
+                                     uint64_t *ids)
+{
+  if (n < 0 || this->state == VEO_STATE_EXIT)
+    return -1;
+  return this->_submitBatch(n, ids, [dst, src, size](int i, Command *cmd) {
+    cmd->setReadMem(dst[i], src[i], size[i]);
+  });
+}
+
+/**
+ * @brief asynchronously write data to VE memory in a batch
+ *
+ * @param n the number of transfers
+ * @param dst array of VEMVAs to write
+ * @param src array of source buffers
+ * @param size array of sizes to transfer in byte
+ * @param[out] ids array to store request IDs
+ * @return the number of requests submitted; -1 upon invalid arguments.
+ */
+int ThreadContext::asyncWriteMemBatch(int n, const uint64_t *dst,
+                                      const void *const *src,
+                                      const size_t *size, uint64_t *ids)
+{
+  if (n < 0 || this->state == VEO_STATE_EXIT)
+    return -1;
+  return this->_submitBatch(n, ids, [dst, src, size](int i, Command *cmd) {
+    cmd->setWriteMem(dst[i], src[i], size[i]);
+  });
 }
 } // namespace veo
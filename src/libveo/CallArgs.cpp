@@ -5,10 +5,11 @@
 
 #include "log.hpp"
 #include "CallArgs.hpp"
+#include "HeapPool.hpp"
+#include <algorithm>
+#include <cerrno>
 #include <cstdio>
 #include <cstring>
-#include <numeric>
-#include <string>
 
 namespace veo{
 namespace internal {
@@ -30,185 +31,62 @@ namespace internal {
  * -------------------
  * ******************* */
 
-template<typename T> void set_value(std::string &str, size_t offset, T value)
+/**
+ * @brief convert a value into an argument
+ *
+ * Integers are sign- or zero-extended to 64 bits on register;
+ * a float is put in the upper 32 bits.
+ */
+template<typename T> void to_arg(Arg &arg, T val)
 {
-  // assume little endian
-  static_assert(std::is_fundamental<T>::value, "T must be fundamental");
-  union {
-    T value_;
-    char image_[sizeof(T)];
-  } data;
-  data.value_ = value;
-  // extend if necessary
-  if (str.size() < offset) {
-    str.resize(offset);
-  }
-  // put
-  str.replace(offset, sizeof(T), data.image_, sizeof(T));
-  // pad for 8 byte-aligned
-  if (sizeof(T) % 8 > 0) {
-    auto padsize = 8 - (sizeof(T) % 8);
-    str.replace(offset + sizeof(T), padsize, padsize, '\0');
-  }
-}
-
-template<typename T> class ArgType: public ArgBase {
-  static_assert(std::is_fundamental<T>::value, "not fundamental type.");
   static_assert(std::is_integral<T>::value, "integer types are supported");
-  T value_;
-public:
-  explicit ArgType(const T arg): value_(arg) {}
-
-  /**
-   * @brief a value on register
-   * @param sp stack pointer
-   * @param n_args the number of arguments
-   * @param used_size the size of stack used
-   * @return a value to be set to on a register
-   */
-  int64_t getRegVal(uint64_t sp, int n_args, size_t &used_size) const {
-    return static_cast<int64_t>(this->value_);
-  }
-
-  void setStackImage(uint64_t sp, std::string &stack, int n,
-                     bool &in, bool &out) {
-    VEO_TRACE(nullptr, "%s(%#lx, _, %d)", __func__, sp, n);
-    out = false;
-    in = false;
-    if (n < NUM_ARGS_ON_REGISTER)
-      return;// do nothing
-    in = true;
-    static_assert(std::is_fundamental<T>::value && sizeof(T) <= 8,
-      "template parameter T must be fundamental");
-    auto pos = PARAM_AREA_OFFSET + n * 8;
-    set_value(stack, pos, this->value_);
-  }
-
-  size_t sizeOnStack() const { return 0;}
-  void copyoutFromStackImage(uint64_t sp, const char *img){}// nothing
-};
-
-template<> class ArgType<double>: public ArgBase {
-  union u {
-    double d_;
-    int64_t i64_;
-    u(double d): d_(d) {}
-  } u_;
-public:
-  explicit ArgType(const double d): u_(d) {}
-  int64_t getRegVal(uint64_t sp, int n_args, size_t &used_size) const {
-    return this->u_.i64_;
-  }
-  void setStackImage(uint64_t sp, std::string &stack, int n,
-                     bool &in, bool &out) {
-    VEO_TRACE(nullptr, "%s(%#lx, _, %d)", __func__, sp, n);
-    out = false;
-    in = false;
-    if (n < NUM_ARGS_ON_REGISTER)
-      return;// do nothing
-    in = true;
-    auto pos = PARAM_AREA_OFFSET + n * 8;
-    set_value(stack, pos, this->u_.i64_);
-  }
-  size_t sizeOnStack() const { return 0;}
-  void copyoutFromStackImage(uint64_t sp, const char *img){}// nothing
-};
-
-template<> class ArgType<float>: public ArgBase {
-  union u {
-    float f_[2];
-    int64_t i64_;
-    u(float f): f_{0.0, f} {}
-  } u_;
-public:
-  explicit ArgType(const float f): u_(f) {}
-  int64_t getRegVal(uint64_t sp, int n_args, size_t &used_size) const {
-    return this->u_.i64_;
-  }
-  void setStackImage(uint64_t sp, std::string &stack, int n,
-                     bool &in, bool &out) {
-    VEO_TRACE(nullptr, "%s(%#lx, _, %d)", __func__, sp, n);
-    out = false;
-    in = false;
-    if (n < NUM_ARGS_ON_REGISTER)
-      return;// do nothing
-    in = true;
-    auto pos = PARAM_AREA_OFFSET + n * 8;
-    set_value(stack, pos, this->u_.i64_);
-  }
-
-  size_t sizeOnStack() const { return 0;}
-  void copyoutFromStackImage(uint64_t sp, const char *img){}// nothing
-};
-
-class ArgOnStack: public ArgBase {
-  char *buff_;
-  size_t len_;
-  bool in_;// copy in from VH memory to VE stack
-  bool out_;// copy out to VH memory from VE stack
-  uint64_t vemva_;
-public:
-  ArgOnStack(char *buff, size_t len, bool in, bool out): buff_(buff),
-    len_(len), in_(in), out_(out) {}
+  arg.value = static_cast<int64_t>(val);
+  arg.size = sizeof(T);
+}
 
-  /**
-   * @brief a value on register
-   * @param sp stack pointer
-   * @param n_args the number of arguments
-   * @param used_size the size of stack used
-   * @return a value to be set to on a register
-   */
-  int64_t getRegVal(uint64_t sp, int n_args, size_t &used_size) const {
-    return this->vemva_;
-  }
+template<> void to_arg<double>(Arg &arg, double val)
+{
+  std::memcpy(&arg.value, &val, sizeof(val));
+  arg.size = 8;
+}
 
-  void setStackImage(uint64_t sp, std::string &stack, int n,
-                     bool &in, bool &out) {
-    VEO_TRACE(nullptr, "%s(%#lx, _, %d)", __func__, sp, n);
-    auto oldlen = stack.size();
-    this->vemva_ = sp + oldlen;
-    in = this->in_;
-    out = this->out_;
-    if (this->in_) {
-      stack.append(this->buff_, this->len_);
-    } else {
-      stack.append(this->len_, '\0');
-    }
-    // padding for 8 byte-aligned
-    if (this->len_ % 8 > 0) {
-      auto n_pad = 8 - (this->len_ % 8);
-      stack.append(n_pad, '\0');
-    }
-    // point the image
-    if (n >= NUM_ARGS_ON_REGISTER) {
-      set_value(stack, PARAM_AREA_OFFSET + 8 * n, this->vemva_);
-    }
-  }
+template<> void to_arg<float>(Arg &arg, float val)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &val, sizeof(val));
+  arg.value = static_cast<uint64_t>(bits) << 32;
+  arg.size = 8;
+}
+} // namespace internal
 
-  size_t sizeOnStack() const {
-    size_t rv = this->len_;
-    if (this->len_ % 8 > 0) {
-      rv += 8 - (this->len_ % 8);
-    }
-    return rv;
-  }
-  void copyoutFromStackImage(uint64_t sp, const char *img) {
-    VEO_TRACE(nullptr, "%s(%#012lx, ...)", __func__, sp);
-    if (!this->out_)
-      return;
-    VEO_DEBUG(nullptr, "copy out to VH: offset %#lx -> %p, size = %d",
-      this->vemva_ - sp, this->buff_, this->len_);
-    std::memcpy(this->buff_, img + (this->vemva_ - sp), this->len_);
+/**
+ * @brief get an argument, extending arguments if necessary
+ * @param argnum argument number
+ * @return reference to the argument
+ *
+ * Arguments skipped on extension are zero.
+ */
+internal::Arg &CallArgs::extend(int argnum)
+{
+  if (argnum < 0 || argnum >= VEO_MAX_NUM_ARGS)
+    throw VEOException("argument number out of range", EINVAL);
+  if (this->num_args <= argnum)
+    ++this->layout_version;
+  for (; this->num_args <= argnum; ++this->num_args) {
+    auto &a = this->arguments[this->num_args];
+    a.type = internal::Arg::VALUE;
+    a.size = 8;
+    a.value = 0;
   }
-};
-} // namespace internal
+  return this->arguments[argnum];
+}
 
 /**
  * @brief push, add at the last, an argument
  * @param val argument value
  */
 template <typename T> void CallArgs::push_(T val) {
-  this->arguments.push_back(std::unique_ptr<internal::ArgBase>(new internal::ArgType<T>(val)));
+  this->set_(this->num_args, val);
 }
 
 /**
@@ -217,11 +95,11 @@ template <typename T> void CallArgs::push_(T val) {
  * @param val argument value
  */
 template <typename T> void CallArgs::set_(int argnum, T val) {
-  if (this->arguments.size() < argnum + 1) {
-    //extend
-    this->arguments.resize(argnum + 1);
-  }
-  this->arguments[argnum] = std::unique_ptr<internal::ArgBase>(new internal::ArgType<T>(val));
+  auto &a = this->extend(argnum);
+  if (a.type != internal::Arg::VALUE)
+    ++this->layout_version;
+  a.type = internal::Arg::VALUE;
+  internal::to_arg(a, val);
 }
 
 // force instantiation
@@ -243,100 +121,485 @@ template void CallArgs::set_<float>(int, float);
  * @param argnum argument number
  * @param buff pointer to memory buffer on VH
  * @param len length of memory buffer on VH
+ *
+ * The layout is kept if the argument was on stack with the same length
+ * and direction, so that setting another buffer of the same length
+ * does not lay out the stack again. A buffer transferred directly is
+ * in the ranges of the layout; the layout is changed if it is moved.
  */
 void CallArgs::setOnStack(enum veo_args_intent inout, int argnum,
                                char *buff, size_t len) {
-  bool copiedin = (inout == VEO_INTENT_IN || inout == VEO_INTENT_INOUT);
-  bool copiedout = (inout == VEO_INTENT_OUT || inout == VEO_INTENT_INOUT);
-  if (this->arguments.size() < argnum + 1) {
-    //extend
-    this->arguments.resize(argnum + 1);
+  auto &a = this->extend(argnum);
+  bool in = (inout == VEO_INTENT_IN || inout == VEO_INTENT_INOUT);
+  bool out = (inout == VEO_INTENT_OUT || inout == VEO_INTENT_INOUT);
+  if (a.type == internal::Arg::ON_STACK && a.stack.len == len
+      && a.in == in && a.out == out && (!a.direct || a.stack.buff == buff)) {
+    // the address on VE stack or heap is kept for the layout.
+    a.stack.buff = buff;
+    a.stack.src = buff;
+    return;
   }
-  this->arguments[argnum] = std::unique_ptr<internal::ArgBase>(new internal::ArgOnStack(buff, len, copiedin, copiedout));
+  ++this->layout_version;
+  a.type = internal::Arg::ON_STACK;
+  a.size = 8;
+  a.in = in;
+  a.out = out;
+  a.stack.buff = buff;
+  a.stack.src = buff;
+  a.stack.len = len;
+  a.stack.vemva = 0;
+  a.direct = a.onHeap();
 }
 
+namespace internal {
 /**
- * @brief get a value on register
- * @param sp stack pointer
- * @return registar arguments
+ * @brief read a value of type T from a packed value block
+ * @param[in,out] p pointer to the value, advanced past it
  */
-std::vector<uint64_t> CallArgs::getRegVal(uint64_t sp) const {
-  size_t stack_consumed = 0;
-  std::vector<uint64_t> rv;
-  int count = 0;
-  for (auto &arg: this->arguments) {
-    rv.push_back(arg->getRegVal(sp, this->numArgs(), stack_consumed));
-    if (++count >= NUM_ARGS_ON_REGISTER)
+template<typename T> T unpack(const char *&p)
+{
+  T val;
+  std::memcpy(&val, p, sizeof(T));
+  p += sizeof(T);
+  return val;
+}
+} // namespace internal
+
+/**
+ * @brief set all arguments from type codes and a packed value block
+ * @param n the number of arguments
+ * @param types type codes (enum veo_arg_type) of n arguments
+ * @param values values packed in the order of arguments without padding
+ *
+ * Arguments from #n are removed. The arguments are not modified if
+ * n or any type code is invalid.
+ */
+void CallArgs::setPacked(int n, const uint8_t *types, const void *values)
+{
+  if (n < 0 || n > VEO_MAX_NUM_ARGS)
+    throw VEOException("the number of arguments out of range", EINVAL);
+  for (int i = 0; i < n; ++i) {
+    if (types[i] > VEO_ARG_STACK_OUT)
+      throw VEOException("invalid type of argument", EINVAL);
+  }
+  if (n < this->num_args) {
+    this->num_args = n;
+    ++this->layout_version;
+  }
+  auto p = static_cast<const char *>(values);
+  for (int i = 0; i < n; ++i) {
+    switch (types[i]) {
+    case VEO_ARG_STACK_IN:
+    case VEO_ARG_STACK_INOUT:
+    case VEO_ARG_STACK_OUT: {
+      auto buff = internal::unpack<char *>(p);
+      auto len = internal::unpack<size_t>(p);
+      this->setOnStack(types[i] == VEO_ARG_STACK_IN ? VEO_INTENT_IN
+                       : types[i] == VEO_ARG_STACK_INOUT ? VEO_INTENT_INOUT
+                       : VEO_INTENT_OUT, i, buff, len);
+      continue;
+    }
+    default:
+      break;
+    }
+    auto &a = this->extend(i);
+    if (a.type != internal::Arg::VALUE)
+      ++this->layout_version;
+    a.type = internal::Arg::VALUE;
+    switch (types[i]) {
+    case VEO_ARG_I64:
+      internal::to_arg(a, internal::unpack<int64_t>(p));
       break;
+    case VEO_ARG_U64:
+      internal::to_arg(a, internal::unpack<uint64_t>(p));
+      break;
+    case VEO_ARG_I32:
+      internal::to_arg(a, internal::unpack<int32_t>(p));
+      break;
+    case VEO_ARG_U32:
+      internal::to_arg(a, internal::unpack<uint32_t>(p));
+      break;
+    case VEO_ARG_I16:
+      internal::to_arg(a, internal::unpack<int16_t>(p));
+      break;
+    case VEO_ARG_U16:
+      internal::to_arg(a, internal::unpack<uint16_t>(p));
+      break;
+    case VEO_ARG_I8:
+      internal::to_arg(a, internal::unpack<int8_t>(p));
+      break;
+    case VEO_ARG_U8:
+      internal::to_arg(a, internal::unpack<uint8_t>(p));
+      break;
+    case VEO_ARG_DOUBLE:
+      internal::to_arg(a, internal::unpack<double>(p));
+      break;
+    case VEO_ARG_FLOAT:
+      internal::to_arg(a, internal::unpack<float>(p));
+      break;
+    }
+  }
+}
+
+/**
+ * @brief take a snapshot of arguments
+ * @return a new object holding the values of arguments and a copy of
+ *         the data of IN buffers; the caller owns it.
+ *
+ * The snapshot copies in the data copied at the time of the snapshot,
+ * and copies out OUT buffers to the original VH buffers.
+ */
+CallArgs *CallArgs::snapshot() const {
+  std::unique_ptr<CallArgs> snap(new CallArgs());
+  size_t data_size = 0;
+  for (int n = 0; n < this->num_args; ++n) {
+    const auto &arg = this->arguments[n];
+    if (arg.type == internal::Arg::ON_STACK && arg.in)
+      data_size += arg.stack.len;
+  }
+  if (data_size > 0)
+    snap->snapshot_data.reset(new char[data_size]);
+  auto data = snap->snapshot_data.get();
+  for (int n = 0; n < this->num_args; ++n) {
+    auto &arg = snap->arguments[n];
+    arg = this->arguments[n];
+    if (arg.type == internal::Arg::ON_STACK && arg.in) {
+      std::memcpy(data, arg.stack.src, arg.stack.len);
+      arg.stack.src = data;
+      data += arg.stack.len;
+    }
+  }
+  snap->num_args = this->num_args;
+  return snap.release();
+}
+
+/**
+ * @brief get values on register
+ * @param[out] regs registar arguments; NUM_ARGS_ON_REGISTER at most.
+ * @return the number of register arguments
+ *
+ * Addresses of arguments on stack are valid after setup().
+ */
+int CallArgs::getRegVal(uint64_t *regs) const {
+  int n = std::min(this->num_args, NUM_ARGS_ON_REGISTER);
+  for (int i = 0; i < n; ++i)
+    regs[i] = this->arguments[i].regVal();
+  return n;
+}
+
+/**
+ * @brief whether any argument is placed on VE heap
+ */
+bool CallArgs::hasHeapArgs() const {
+  for (int n = 0; n < this->num_args; ++n) {
+    if (this->arguments[n].onHeap())
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @brief acquire VE heap buffers for arguments placed on heap
+ * @param pool pool of VE heap buffers
+ * @return true upon success; false if a buffer cannot be acquired.
+ *
+ * Call this before setup(), and releaseHeap() after copyout().
+ * Buffers are not cleared; OUT buffers keep data of previous calls.
+ */
+bool CallArgs::acquireHeap(HeapPool &pool) {
+  for (int n = 0; n < this->num_args; ++n) {
+    auto &arg = this->arguments[n];
+    if (!arg.onHeap())
+      continue;
+    arg.stack.vemva = pool.acquire(arg.stack.len);
+    if (arg.stack.vemva == 0) {
+      for (int i = 0; i < n; ++i) {
+        auto &a = this->arguments[i];
+        if (a.onHeap())
+          pool.release(a.stack.vemva, a.stack.len);
+      }
+      return false;
+    }
+    VEO_DEBUG(nullptr, "arg#%d on VE heap %#lx, size = %d",
+              n, arg.stack.vemva, arg.stack.len);
   }
-  return rv;
+  return true;
 }
 
 /**
- * @brief get the stack image
- * @param[in,out] sp reference to stack pointer
- * @return stack image
+ * @brief release VE heap buffers acquired by acquireHeap()
+ * @param pool pool of VE heap buffers
  */
-std::string CallArgs::getStackImage(uint64_t &sp) {
-  VEO_TRACE(nullptr, "getStackImage(%#lx)", sp);
-  // allocate stack
-  size_t stack_size = PARAM_AREA_OFFSET + 8 * this->numArgs()
-    + std::accumulate(this->arguments.begin(), this->arguments.end(), 0,
-        [](size_t s, decltype(this->arguments)::reference arg) {
-          return s + arg->sizeOnStack();
-        });
+void CallArgs::releaseHeap(HeapPool &pool) {
+  for (int n = 0; n < this->num_args; ++n) {
+    const auto &arg = this->arguments[n];
+    if (arg.onHeap())
+      pool.release(arg.stack.vemva, arg.stack.len);
+  }
+}
+
+/**
+ * @brief add a range to transfer
+ * @param ranges ranges
+ * @param[in,out] n the number of ranges
+ * @param offset offset of the range
+ * @param len length of the range
+ * @param buff VH buffer transferred directly; nullptr for stack image.
+ *
+ * A range of the stack image adjacent to the last one is merged into it.
+ */
+static void add_range(internal::Range *ranges, int &n, size_t offset,
+                      size_t len, char *buff)
+{
+  if (buff == nullptr && n > 0 && ranges[n - 1].buff == nullptr
+      && ranges[n - 1].offset + ranges[n - 1].len == offset) {
+    ranges[n - 1].len += len;
+    return;
+  }
+  ranges[n].offset = offset;
+  ranges[n].len = len;
+  ranges[n].buff = buff;
+  ++n;
+}
+
+/**
+ * @brief lay out arguments on stack and build the stack image
+ * @param[in,out] sp reference to stack pointer, shifted by the stack used
+ *
+ * The image is written in one pass into the buffer kept by the object,
+ * and the ranges to copy in and out are computed: arguments in the
+ * parameter area and IN buffers are copied in, and OUT buffers are
+ * copied out. Buffers of DIRECT_COPY_SIZE or larger are left out of
+ * the image and transferred from and to VH memory directly.
+ * Buffers of HEAP_SPILL_SIZE or larger are not placed on stack but on
+ * VE heap by acquireHeap(). OUT buffers are not copied in nor cleared.
+ */
+void CallArgs::setup(uint64_t &sp)
+{
+  VEO_TRACE(nullptr, "setup CallArgs (sp = %#lx)...", sp);
+  size_t param_size = PARAM_AREA_OFFSET + 8 * this->num_args;
+  size_t stack_size = param_size;
+  bool on_stack = this->num_args > NUM_ARGS_ON_REGISTER;
+  for (int n = 0; n < this->num_args; ++n) {
+    const auto &arg = this->arguments[n];
+    stack_size += arg.sizeOnStack();
+    on_stack = on_stack
+      || (arg.type == internal::Arg::ON_STACK && !arg.onHeap());
+  }
   VEO_TRACE(nullptr, "stack size = %lu", stack_size);
   this->stack_size = stack_size;
   sp -= stack_size;// shift stack pointer
   this->stack_top = sp;
-  std::string stack(PARAM_AREA_OFFSET + 8 * this->numArgs(), '\0');
+  this->num_in_ranges = 0;
+  this->num_out_ranges = 0;
+  // arguments only on register need no stack image.
+  if (!on_stack)
+    return;
 
-  int n = 0;
-  this->copied_in = false;
-  this->copied_out = false;
-  for (const auto &arg: this->arguments) {
-    bool i, o;
-    arg->setStackImage(sp, stack, n++, i, o);
-    this->copied_in = this->copied_in || i;
-    this->copied_out = this->copied_out || o;
+  if (this->stack_buf_size < stack_size) {
+    this->stack_buf.reset(new char[stack_size]);
+    this->stack_buf_size = stack_size;
   }
-  return stack;
+  auto img = this->stack_buf.get();
+  if (this->num_args > NUM_ARGS_ON_REGISTER) {
+    auto offset = PARAM_AREA_OFFSET + 8 * NUM_ARGS_ON_REGISTER;
+    add_range(this->in_ranges, this->num_in_ranges, offset,
+              param_size - offset, nullptr);
+  }
+  auto offset = param_size;
+  for (int n = 0; n < this->num_args; ++n) {
+    auto &arg = this->arguments[n];
+    if (arg.onHeap()) {
+      // placed by acquireHeap(); transferred by copyin() and copyout().
+      arg.direct = true;
+    } else if (arg.type == internal::Arg::ON_STACK) {
+      auto len = arg.stack.len;
+      auto padded = arg.sizeOnStack();
+      arg.stack.vemva = sp + offset;
+      arg.direct = len >= DIRECT_COPY_SIZE;
+      if (arg.in && !arg.direct) {
+        std::memcpy(img + offset, arg.stack.src, len);
+        // padding for 8 byte-aligned
+        std::memset(img + offset + len, 0, padded - len);
+      }
+      if (arg.in)
+        add_range(this->in_ranges, this->num_in_ranges, offset,
+                  arg.direct ? len : padded,
+                  arg.direct ? arg.stack.src : nullptr);
+      if (arg.out)
+        add_range(this->out_ranges, this->num_out_ranges, offset,
+                  arg.direct ? len : padded,
+                  arg.direct ? arg.stack.buff : nullptr);
+      offset += padded;
+    }
+    if (n >= NUM_ARGS_ON_REGISTER) {
+      // assume little endian
+      auto v = arg.stackVal();
+      std::memcpy(img + PARAM_AREA_OFFSET + 8 * n, &v, sizeof(v));
+    }
+  }
+  VEO_ASSERT(offset == stack_size);
 }
 
-void CallArgs::setup(uint64_t &sp)
+/**
+ * @brief read IN buffers on stack again into the stack image
+ *
+ * The stack image set up before is reused as is, except for the data
+ * of IN buffers, which can have been updated by the caller.
+ * IN buffers transferred directly are read on copyin().
+ */
+void CallArgs::refresh()
 {
-  VEO_TRACE(nullptr, "setup CallArgs (sp = %#lx)...", sp);
-  auto img = this->getStackImage(sp);
-  VEO_ASSERT(this->stack_size == img.size());
-  auto buf = new char[this->stack_size];
-  memcpy(buf, img.c_str(), this->stack_size);
-  this->stack_buf.reset(buf);
+  for (int n = 0; n < this->num_args; ++n) {
+    const auto &arg = this->arguments[n];
+    if (arg.type == internal::Arg::ON_STACK && arg.in && !arg.direct)
+      std::memcpy(this->stack_buf.get() + (arg.stack.vemva - this->stack_top),
+                  arg.stack.src, arg.stack.len);
+  }
 }
 
+/**
+ * @brief write values of arguments into the stack image laid out before
+ *
+ * Values in the parameter area and the data of IN buffers are read
+ * again; the layout must not have changed since setup().
+ */
+void CallArgs::update()
+{
+  auto img = this->stack_buf.get();
+  for (int n = NUM_ARGS_ON_REGISTER; n < this->num_args; ++n) {
+    // assume little endian
+    auto v = this->arguments[n].stackVal();
+    std::memcpy(img + PARAM_AREA_OFFSET + 8 * n, &v, sizeof(v));
+  }
+  this->refresh();
+}
+
+/**
+ * @brief transfer arguments on stack and on VE heap to VE
+ * @param xfer function to transfer data: xfer(dst, src, size)
+ */
 void CallArgs::copyin(std::function<int(uint64_t, const void *, size_t)> xfer)
 {
-  if (this->copied_in) {
-    VEO_TRACE(nullptr, "transfer stack image (VH %p -> VE %#lx, %d bytes)",
-              this->stack_buf.get(), this->stack_top, this->stack_size);
-    xfer(this->stack_top, this->stack_buf.get(), this->stack_size);
-  } else {
+  if (this->num_in_ranges == 0) {
     VEO_TRACE(nullptr, "the current stack (%#lx) is not copied in.",
               this->stack_top);
   }
+  for (int i = 0; i < this->num_in_ranges; ++i) {
+    const auto &r = this->in_ranges[i];
+    const char *src = r.buff ? r.buff : this->stack_buf.get() + r.offset;
+    VEO_TRACE(nullptr, "copy in (VH %p -> VE %#lx, %d bytes)",
+              src, this->stack_top + r.offset, r.len);
+    xfer(this->stack_top + r.offset, src, r.len);
+  }
+  this->copyinHeap(xfer);
 }
 
-void CallArgs::copyout(std::function<int(void *, uint64_t, size_t)> xfer)
+/**
+ * @brief transfer IN buffers placed on VE heap
+ * @param xfer function to transfer data: xfer(dst, src, size)
+ */
+void CallArgs::copyinHeap(
+  std::function<int(uint64_t, const void *, size_t)> &xfer)
+{
+  for (int n = 0; n < this->num_args; ++n) {
+    const auto &arg = this->arguments[n];
+    if (!arg.onHeap() || !arg.in)
+      continue;
+    VEO_TRACE(nullptr, "copy in to VE heap (VH %p -> VE %#lx, %d bytes)",
+              arg.stack.src, arg.stack.vemva, arg.stack.len);
+    xfer(arg.stack.vemva, arg.stack.src, arg.stack.len);
+  }
+}
+
+/**
+ * @brief transfer arguments on stack to VE, skipping unchanged ranges
+ * @param xfer function to transfer data: xfer(dst, src, size)
+ * @param shadow copy of the stack image on VE, stackSize() bytes;
+ *        updated by the transfers.
+ * @param valid true if VE stack holds the shadow.
+ *
+ * Only the bytes of a range of the stack image changed from the shadow
+ * are transferred if the range does not overlap OUT buffers, which VE
+ * can modify.
+ * Buffers transferred directly and buffers on VE heap are always
+ * transferred.
+ */
+void CallArgs::copyinChanged(
+  std::function<int(uint64_t, const void *, size_t)> xfer,
+  char *shadow, bool valid)
 {
-  if (this->copied_out) {
-    VEO_TRACE(nullptr, "transfer stack image (VE %#lx -> VH %p, %d bytes)",
-              this->stack_top, this->stack_buf.get(), this->stack_size);
-    xfer(this->stack_buf.get(), this->stack_top, this->stack_size);
-    for (auto &arg: this->arguments) {
-      arg->copyoutFromStackImage(this->stack_top, this->stack_buf.get());
+  auto img = this->stack_buf.get();
+  for (int i = 0; i < this->num_in_ranges; ++i) {
+    const auto &r = this->in_ranges[i];
+    if (r.buff != nullptr) {
+      xfer(this->stack_top + r.offset, r.buff, r.len);
+      continue;
+    }
+    bool stable = true;
+    for (int j = 0; j < this->num_out_ranges; ++j) {
+      const auto &o = this->out_ranges[j];
+      if (o.offset < r.offset + r.len && r.offset < o.offset + o.len)
+        stable = false;
+    }
+    auto begin = r.offset;
+    auto end = r.offset + r.len;
+    if (stable && valid) {
+      // narrow the range to the bytes changed
+      while (begin < end && shadow[begin] == img[begin])
+        ++begin;
+      while (end > begin && shadow[end - 1] == img[end - 1])
+        --end;
+      if (begin == end) {
+        VEO_TRACE(nullptr, "skip copy in (VE %#lx, %d bytes)",
+                  this->stack_top + r.offset, r.len);
+        continue;
+      }
     }
-  } else {
+    VEO_TRACE(nullptr, "copy in (VH %p -> VE %#lx, %d bytes)",
+              img + begin, this->stack_top + begin, end - begin);
+    if (xfer(this->stack_top + begin, img + begin, end - begin) == 0
+        && stable)
+      std::memcpy(shadow + begin, img + begin, end - begin);
+  }
+  this->copyinHeap(xfer);
+}
+
+/**
+ * @brief transfer OUT buffers on stack and on VE heap from VE
+ * @param xfer function to transfer data: xfer(dst, src, size)
+ */
+void CallArgs::copyout(std::function<int(void *, uint64_t, size_t)> xfer)
+{
+  for (int n = 0; n < this->num_args; ++n) {
+    const auto &arg = this->arguments[n];
+    if (!arg.onHeap() || !arg.out)
+      continue;
+    VEO_TRACE(nullptr, "copy out from VE heap (VE %#lx -> VH %p, %d bytes)",
+              arg.stack.vemva, arg.stack.buff, arg.stack.len);
+    xfer(arg.stack.buff, arg.stack.vemva, arg.stack.len);
+  }
+  if (this->num_out_ranges == 0) {
     VEO_TRACE(nullptr, "the current stack (%#lx) is not copied out.",
               this->stack_top);
+    return;
+  }
+  for (int i = 0; i < this->num_out_ranges; ++i) {
+    const auto &r = this->out_ranges[i];
+    char *dst = r.buff ? r.buff : this->stack_buf.get() + r.offset;
+    VEO_TRACE(nullptr, "copy out (VE %#lx -> VH %p, %d bytes)",
+              this->stack_top + r.offset, dst, r.len);
+    xfer(dst, this->stack_top + r.offset, r.len);
+  }
+  for (int n = 0; n < this->num_args; ++n) {
+    const auto &arg = this->arguments[n];
+    if (arg.type != internal::Arg::ON_STACK || !arg.out || arg.direct)
+      continue;
+    VEO_DEBUG(nullptr, "copy out to VH: offset %#lx -> %p, size = %d",
+      arg.stack.vemva - this->stack_top, arg.stack.buff, arg.stack.len);
+    std::memcpy(arg.stack.buff,
+                this->stack_buf.get() + (arg.stack.vemva - this->stack_top),
+                arg.stack.len);
   }
 }
 } // namespace veo
@@ -9,46 +9,114 @@
 #define _VEO_CALL_ARGS_HPP_
 #include <functional>
 #include <memory>
-#include <string>
-#include <vector>
 #include <type_traits>
 #include <initializer_list>
 #include "ve_offload.h"
 #include "VEOException.hpp"
 
 namespace veo {
+class HeapPool;
+
 constexpr int NUM_ARGS_ON_REGISTER = 8;
 constexpr int PARAM_AREA_OFFSET = 176;
+// buffers on stack from this size are transferred from and to VH memory
+// directly instead of through the stack image.
+constexpr size_t DIRECT_COPY_SIZE = 64 * 1024;
+// buffers on stack from this size are placed on VE heap instead.
+constexpr size_t HEAP_SPILL_SIZE = 1024 * 1024;
 namespace internal {
 /**
- * Base abstract class of an argument
+ * @brief argument stored inline in CallArgs
+ */
+struct Arg {
+  enum Type: uint8_t {
+    VALUE,//!< scalar value
+    ON_STACK,//!< buffer on stack
+  };
+  uint8_t type;
+  uint8_t size;//!< size of a value in the stack image
+  bool in;// copy in from VH memory to VE stack
+  bool out;// copy out to VH memory from VE stack
+  bool direct;// transferred not through the stack image
+  union {
+    uint64_t value;//!< value on register
+    struct {
+      char *buff;//!< VH buffer copied out to
+      char *src;//!< VH data copied in; buff unless snapshotted
+      size_t len;
+      uint64_t vemva;//!< address of the buffer on VE stack or heap
+    } stack;
+  };
+
+  /**
+   * @brief a value on register
+   */
+  uint64_t regVal() const {
+    return this->type == VALUE ? this->value : this->stack.vemva;
+  }
+  /**
+   * @brief a value in the parameter area on stack
+   *
+   * Integers are put zero-extended from their own size.
+   */
+  uint64_t stackVal() const {
+    auto v = this->regVal();
+    return this->size < 8 ? v & ((1UL << (8 * this->size)) - 1) : v;
+  }
+  /**
+   * @brief whether the buffer is placed on VE heap instead of stack
+   */
+  bool onHeap() const {
+    return this->type == ON_STACK && this->stack.len >= HEAP_SPILL_SIZE;
+  }
+  /**
+   * @brief size of the data on stack, 8 byte-aligned
+   */
+  size_t sizeOnStack() const {
+    return this->type == ON_STACK && !this->onHeap()
+      ? (this->stack.len + 7) & ~7UL : 0;
+  }
+};
+
+/**
+ * @brief range of the stack transferred between VH and VE
  */
-struct ArgBase {
-  virtual ~ArgBase() = default;
-  virtual int64_t getRegVal(uint64_t, int, size_t &) const = 0;
-  virtual size_t sizeOnStack() const = 0;
-  virtual void setStackImage(uint64_t, std::string &, int, bool &, bool &) = 0;
-  virtual void copyoutFromStackImage(uint64_t, const char *) = 0;
+struct Range {
+  size_t offset;//!< offset from the stack top
+  size_t len;//!< length in bytes
+  char *buff;//!< VH buffer transferred directly; nullptr for stack image.
 };
 } // namespace internal
 
 class CallArgs {
-  std::vector<std::unique_ptr<internal::ArgBase> > arguments;
+  internal::Arg arguments[VEO_MAX_NUM_ARGS];
+  int num_args;
+  uint64_t layout_version;// changed when the layout on stack can change
   template<typename T> void push_(T val);
   template<typename T> void set_(int argnum, T val);
+  internal::Arg &extend(int argnum);
+  void copyinHeap(std::function<int(uint64_t, const void *, size_t)> &);
 
   uint64_t stack_top;
   size_t stack_size;
-  std::unique_ptr<char[]> stack_buf;
+  std::unique_ptr<char[]> stack_buf;// reused while large enough
+  size_t stack_buf_size;
 
-  bool copied_in;// necessary to copy stack image to VE
-  bool copied_out;// necessary to copy stack image out from VE
+  // ranges to copy in to VE and to copy out from VE
+  internal::Range in_ranges[VEO_MAX_NUM_ARGS + 1];
+  internal::Range out_ranges[VEO_MAX_NUM_ARGS];
+  int num_in_ranges;
+  int num_out_ranges;
 
-  std::string getStackImage(uint64_t &);
+  bool snapshot_mode;// snapshot on submission
+  std::unique_ptr<char[]> snapshot_data;// IN data of a snapshot
 
 public:
-  CallArgs(): arguments(0) {}
-  CallArgs(std::initializer_list<int64_t> args) {
+  CallArgs(): num_args(0), layout_version(0), stack_buf_size(0),
+    num_in_ranges(0), num_out_ranges(0), snapshot_mode(false) {}
+  CallArgs(std::initializer_list<int64_t> args): num_args(0),
+    layout_version(0), stack_buf_size(0), num_in_ranges(0),
+    num_out_ranges(0), snapshot_mode(false) {
     for (auto a: args)
       this->push_(a);
   }
@@ -59,7 +127,8 @@ public:
    * @brief clear all aruguments
    */
   void clear() {
-    this->arguments.clear();
+    this->num_args = 0;
+    ++this->layout_version;
   }
 
   /**
@@ -75,18 +144,48 @@ public:
 
   void setOnStack(enum veo_args_intent inout, int argnum,
                   char *buff, size_t len);
+  void setPacked(int, const uint8_t *, const void *);
 
   /**
    * @brief number of arguments for VEO function
    */
   int numArgs() const {
-    return this->arguments.size();
+    return this->num_args;
   }
 
-  std::vector<uint64_t> getRegVal(uint64_t) const;
+  /**
+   * @brief version of the layout on stack
+   *
+   * The version is changed when arguments are added or cleared, or
+   * when an argument is set on stack with another length or direction,
+   * or from or to a value.
+   */
+  uint64_t layoutVersion() const { return this->layout_version; }
+
+  /**
+   * @brief enable or disable snapshot on submission
+   *
+   * In snapshot mode, a call takes a snapshot of the arguments when
+   * submitted, so that the arguments can be set again for the next
+   * call without waiting for the completion.
+   */
+  void setSnapshot(bool on) { this->snapshot_mode = on; }
+  bool isSnapshot() const { return this->snapshot_mode; }
+  CallArgs *snapshot() const;
+  uint64_t stackTop() const { return this->stack_top; }
+  size_t stackSize() const { return this->stack_size; }
+
+  int getRegVal(uint64_t *) const;
+  bool hasHeapArgs() const;
+  bool acquireHeap(HeapPool &);
+  void releaseHeap(HeapPool &);
 
   void setup(uint64_t &);
+  void refresh();
+  void update();
   void copyin(std::function<int(uint64_t, const void *, size_t)>);
+  void copyinChanged(std::function<int(uint64_t, const void *, size_t)>,
+                     char *, bool);
   void copyout(std::function<int(void *, uint64_t, size_t)>);
 
   veo_args *toCHandle() {
@@ -0,0 +1,74 @@
+/**
+ * @file CallPlan.cpp
+ * @brief implementation of call plans
+ */
+#include "CallPlan.hpp"
+#include "CallArgs.hpp"
+#include "ThreadContext.hpp"
+#include "log.hpp"
+
+namespace veo {
+/**
+ * @brief launch a call plan
+ *
+ * @param plan plan created on this context
+ * @return request ID; the index of the node while capturing.
+ */
+uint64_t ThreadContext::launchPlan(CallPlan *plan)
+{
+  if (this->state == VEO_STATE_EXIT || plan->ctx != this)
+    return VEO_REQUEST_ID_INVALID;
+  return this->_submit(nullptr, nullptr, VEO_PRIO_NORMAL,
+                       [plan](Command *cmd) {
+                         cmd->setLaunchPlan(plan->addr, plan->args, plan);
+                       });
+}
+
+/**
+ * @brief start the call of a plan on VE thread
+ *
+ * @param plan plan of the call
+ *
+ * The arguments are laid out when the plan is launched first or when
+ * the layout of the arguments or the stack pointer has changed;
+ * otherwise, only the values of the arguments are written into
+ * the stack image laid out before.
+ */
+void ThreadContext::_doPlanCall(CallPlan &plan)
+{
+  auto &args = *plan.args;
+  if (plan.sp != this->ve_sp || plan.layout != args.layoutVersion()
+      || plan.top != args.stackTop()) {
+    VEO_DEBUG(this, "lay out call plan for sp = %p", (void *)this->ve_sp);
+    plan.sp = this->ve_sp;
+    plan.layout = args.layoutVersion();
+    args.setup(this->ve_sp);
+    plan.top = this->ve_sp;
+    if (plan.shadow_size < args.stackSize()) {
+      plan.shadow.reset(new char[args.stackSize()]);
+      plan.shadow_size = args.stackSize();
+    }
+    // the shadow is not valid for the new layout.
+    if (this->stack_owner == &plan)
+      this->stack_owner = nullptr;
+  } else {
+    args.update();
+    this->ve_sp = plan.top;
+  }
+  plan.nregs = args.getRegVal(plan.regs);
+  this->_startCall(plan.addr, args, plan.regs, plan.nregs, &plan);
+}
+
+/**
+ * @brief function to be set to launch plan request (command)
+ */
+int ThreadContext::_launchPlanCommandHandler(Command *cmd)
+{
+  VEO_TRACE(this, "[request #%lu] launch plan %p", cmd->getID(),
+            cmd->param.call.plan);
+  if (!this->_acquireHeap(cmd))
+    return 0;
+  this->_doPlanCall(*cmd->param.call.plan);
+  return this->_waitCall(cmd);
+}
+} // namespace veo
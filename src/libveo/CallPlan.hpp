@@ -0,0 +1,53 @@
+/**
+ * @file CallPlan.hpp
+ * @brief plans of function calls launched repeatedly
+ *
+ * @internal
+ * @author VEO
+ */
+#ifndef _VEO_CALL_PLAN_HPP_
+#define _VEO_CALL_PLAN_HPP_
+#include <memory>
+#include "CallArgs.hpp"
+
+namespace veo {
+class ThreadContext;
+
+/**
+ * @brief call of a VE function with a frozen argument layout
+ *
+ * The arguments are laid out on the first launch, and later launches
+ * only write the values of the arguments into the stack image laid
+ * out. The plan keeps a shadow of the stack image on VE, so that ranges
+ * of the image unchanged since the previous launch are not transferred
+ * while VE stack is not used by other calls.
+ * The layout is made again when the layout of the arguments or
+ * the stack pointer changes.
+ */
+class CallPlan {
+  friend class ThreadContext;
+  ThreadContext *ctx;
+  uint64_t addr;
+  CallArgs *args;
+
+  // state on pseudo thread
+  uint64_t sp;/*! stack pointer the arguments are laid out for */
+  uint64_t top;/*! stack pointer with the arguments on stack */
+  uint64_t layout;/*! layout version of the arguments */
+  uint64_t regs[NUM_ARGS_ON_REGISTER];/*! arguments on registers */
+  int nregs;
+  std::unique_ptr<char[]> shadow;/*! stack image on VE */
+  size_t shadow_size;
+
+public:
+  CallPlan(ThreadContext *c, uint64_t a, CallArgs *ca): ctx(c), addr(a),
+    args(ca), sp(0), top(0), layout(0), nregs(0), shadow_size(0) {}
+  CallPlan(const CallPlan &) = delete;
+  ThreadContext *getContext() { return this->ctx; }
+
+  veo_call_plan *toCHandle() {
+    return reinterpret_cast<veo_call_plan *>(this);
+  }
+};
+} // namespace veo
+#endif
@@ -2,127 +2,892 @@
  * @file Command.cpp
  * @brief implementation of communication between main and pseudo thread
  */
+#include <algorithm>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
 #include "Command.hpp"
+#include "CallArgs.hpp"
+#include "Futex.hpp"
+#include "CompletionExecutor.hpp"
+#include "Event.hpp"
 
 namespace veo {
-typedef std::unique_ptr<Command> CmdPtr;
+
+RequestQueue::RequestQueue(): tail(0), head(0), space(0),
+  producers_parked(0)
+{
+  for (uint64_t i = 0; i < CAPACITY; ++i) {
+    this->ring[i].seq.store(i, std::memory_order_relaxed);
+    this->ring[i].cmd = nullptr;
+  }
+}
+
+/**
+ * @brief reserve consecutive tickets to push commands
+ * @param n the number of tickets to reserve; at most CAPACITY.
+ * @return the first ticket reserved
+ *
+ * This function blocks while the queue does not have n free slots.
+ * The caller must publish a command with each ticket by publish().
+ */
+uint64_t RequestQueue::reserve(size_t n)
+{
+  uint64_t pos = this->tail.load(std::memory_order_relaxed);
+  for (;;) {
+    // The consumer frees slots in order; if the slot of the last ticket
+    // is free, so are the others.
+    uint64_t last = pos + n - 1;
+    Slot &slot = this->ring[last & MASK];
+    uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    int64_t diff = static_cast<int64_t>(seq - last);
+    if (diff == 0) {
+      // the slots are free; try to reserve the tickets.
+      if (this->tail.compare_exchange_weak(pos, pos + n,
+                                           std::memory_order_relaxed))
+        break;
+      // pos is updated by the failed CAS.
+    } else if (diff < 0) {
+      // full: the consumer has not popped the command CAPACITY ago yet.
+      this->waitForSpace(last);
+      pos = this->tail.load(std::memory_order_relaxed);
+    } else {
+      // another producer has reserved the ticket.
+      pos = this->tail.load(std::memory_order_relaxed);
+    }
+  }
+  return pos;
+}
 
 /**
- * @brief push a command to queue
+ * @brief publish a command to the pseudo thread
+ * @param pos ticket reserved by reserve()
  * @param cmd a pointer to a command to be pushed (sent).
+ *
+ * The caller is responsible to wake the pseudo thread.
  */
-void BlockingQueue::push(CmdPtr cmd) {
-  std::lock_guard<std::mutex> lock(this->mtx);
-  this->queue.push_back(std::move(cmd));
-  this->cond.notify_all();
+void RequestQueue::publish(uint64_t pos, Command *cmd)
+{
+  Slot &slot = this->ring[pos & MASK];
+  slot.cmd = cmd;
+  slot.seq.store(pos + 1, std::memory_order_release);
 }
 
 /**
- * @brief pop a command from queue
- * @return a pointer to a command to be poped (received).
+ * @brief pop a command from queue without blocking
+ * @return a pointer to the first command; nullptr if the queue is empty.
+ *
+ * Only the pseudo thread can call this function.
+ */
+Command *RequestQueue::popNoWait()
+{
+  uint64_t pos = this->head.load(std::memory_order_relaxed);
+  Slot &slot = this->ring[pos & MASK];
+  if (slot.seq.load(std::memory_order_acquire) != pos + 1)
+    return nullptr;// not published yet
+  Command *cmd = slot.cmd;
+  slot.cmd = nullptr;
+  // make the slot free for the ticket of the next round.
+  slot.seq.store(pos + CAPACITY, std::memory_order_release);
+  this->head.store(pos + 1, std::memory_order_relaxed);
+  this->wakeProducers();
+  return cmd;
+}
+
+/**
+ * @brief wait until the slot for a ticket is freed
+ * @param pos ticket whose slot is in use
+ */
+void RequestQueue::waitForSpace(uint64_t pos)
+{
+  uint32_t s = this->space.load(std::memory_order_acquire);
+  this->producers_parked.fetch_add(1, std::memory_order_seq_cst);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  uint64_t seq = this->ring[pos & MASK].seq.load(std::memory_order_acquire);
+  if (static_cast<int64_t>(seq - pos) < 0)
+    internal::futex_wait(&this->space, s);
+  this->producers_parked.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief wake producers waiting for a free slot
+ */
+void RequestQueue::wakeProducers()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (this->producers_parked.load(std::memory_order_relaxed) != 0) {
+    this->space.fetch_add(1, std::memory_order_release);
+    internal::futex_wake(&this->space);
+  }
+}
+
+/**
+ * @brief wake threads waiting for any completion if exist
+ */
+void CompletionNotifier::notify()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (this->waiters.load(std::memory_order_relaxed) != 0) {
+    this->epoch.fetch_add(1, std::memory_order_release);
+    internal::futex_wake(&this->epoch);
+  }
+}
+
+/**
+ * @brief register the calling thread as a waiter
+ * @return the current epoch to be passed to wait()
+ *
+ * The caller must check the completion of the requests to wait for after
+ * this function and call finish() when it stops waiting.
+ */
+uint32_t CompletionNotifier::prepare()
+{
+  this->waiters.fetch_add(1, std::memory_order_seq_cst);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  return this->epoch.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief sleep until a completion after prepare()
+ * @param e epoch returned by prepare()
+ * @param timeout relative timeout; nullptr to wait infinitely.
+ *
+ * This function can return spuriously.
+ */
+void CompletionNotifier::wait(uint32_t e, const struct timespec *timeout)
+{
+  internal::futex_wait(&this->epoch, e, timeout);
+}
+
+/**
+ * @brief unregister the calling thread
+ */
+void CompletionNotifier::finish()
+{
+  this->waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+CompletionNotifier CompletionTable::notifier;
+
+CompletionTable::CompletionTable(): num_overflow(0), policy(VEO_WAIT_PARK),
+  estimate(INITIAL_ESTIMATE_NS)
+{
+  // the slots look freed by the generation before the first request,
+  // so that a slot not acquired yet is not taken for a finished request.
+  for (auto &slot: this->slots)
+    slot.state.store(tagOf(0 - CAPACITY) | FREE, std::memory_order_relaxed);
+}
+
+/**
+ * @brief move the result left in a slot to the overflow map
+ * @param slot slot holding a result not picked up
+ * @param msgid request ID of the result
+ * @param[in,out] s the state of the slot loaded; updated on failure.
+ * @return true if the result is moved; false if the state has changed.
+ *
+ * The slot is held in PENDING with the old tag while the result is
+ * moved, so that threads waiting for the old request keep waiting and
+ * find the result in the map after the slot is reused.
+ */
+bool CompletionTable::moveToOverflow(Slot &slot, uint64_t msgid, uint32_t &s)
+{
+  auto held = (s & (TAG_MASK | WAITING)) | PENDING;
+  if (!slot.state.compare_exchange_strong(s, held,
+                                          std::memory_order_acq_rel))
+    return false;// s is updated by the failed CAS.
+  Result r = {slot.status, slot.retval};
+  {
+    std::lock_guard<std::mutex> lock(this->overflow_mtx);
+    this->overflow[msgid] = r;
+    this->num_overflow.fetch_add(1, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+/**
+ * @brief take the result of a request from the overflow map
+ * @param msgid request ID
+ * @param[out] status the status of the command
+ * @param[out] retp pointer to buffer to store the return value
+ * @return true if the result is found and removed.
+ */
+bool CompletionTable::takeOverflow(uint64_t msgid, int &status,
+                                   uint64_t *retp)
+{
+  if (this->num_overflow.load(std::memory_order_relaxed) == 0)
+    return false;
+  std::lock_guard<std::mutex> lock(this->overflow_mtx);
+  auto it = this->overflow.find(msgid);
+  if (it == this->overflow.end())
+    return false;
+  status = it->second.status;
+  *retp = it->second.retval;
+  this->overflow.erase(it);
+  this->num_overflow.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+/**
+ * @brief wait until the command of a request can be reused
+ * @param msgid request ID to use the command
  *
- * This function gets the first command in the queue.
- * If the queue is empty, this function blocks until a command is pushed.
+ * The command is in use until the request COMMANDS before has finished
+ * and left the request queue. Its result slot tells it: the tag of
+ * the request without IN_FLIGHT and RINGED, or a newer tag, which is
+ * acquired only after that.
  */
-CmdPtr BlockingQueue::pop() {
+void CompletionTable::waitCommand(uint64_t msgid)
+{
+  if (msgid < COMMANDS)
+    return;
+  auto prev = msgid - COMMANDS;
+  Slot &slot = this->slots[prev & MASK];
+  auto s = slot.state.load(std::memory_order_acquire);
   for (;;) {
-    std::unique_lock<std::mutex> lock(this->mtx);
-    if (!this->queue.empty()) {
-      auto rv = std::move(this->queue.front());
-      this->queue.pop_front();
-      return rv;
+    auto diff = (tagOf(prev) - (s & TAG_MASK)) & TAG_MASK;
+    if (diff == 0 ? (s & (RINGED | IN_FLIGHT)) == 0 : diff >= TAG_MASK / 2)
+      return;
+    if ((s & WAITING) == 0 &&
+        !slot.state.compare_exchange_weak(s, s | WAITING,
+                                          std::memory_order_acq_rel))
+      continue;// s is updated by the failed CAS.
+    internal::futex_wait(&slot.state, s | WAITING);
+    s = slot.state.load(std::memory_order_acquire);
+  }
+}
+
+/**
+ * @brief get the commands for new requests
+ * @param msgid the first request ID issued
+ * @param n the number of request IDs issued; at most COMMANDS.
+ * @return a pointer to the command of the first request; the others
+ *         are got by get().
+ *
+ * The request IDs of the commands are set. The results of the requests
+ * CAPACITY before, if not picked up yet, are moved to the overflow map.
+ * This function blocks while the request COMMANDS or CAPACITY before
+ * has not been issued, has not finished or is still in a request queue;
+ * the caller must not hold a ticket of a request queue not published
+ * yet, which could keep the request before from being executed.
+ * The commands must be pushed to a request queue.
+ */
+Command *CompletionTable::acquire(uint64_t msgid, size_t n)
+{
+  for (size_t i = 0; i < n; ++i) {
+    auto id = msgid + i;
+    this->waitCommand(id);
+    Slot &slot = this->slots[id & MASK];
+    auto s = slot.state.load(std::memory_order_acquire);
+    for (;;) {
+      bool prev = id < CAPACITY || (s & TAG_MASK) == tagOf(id - CAPACITY);
+      if (prev && (s & RINGED) == 0) {
+        if ((s & PHASE_MASK) == DONE) {
+          if (this->moveToOverflow(slot, id - CAPACITY, s))
+            break;
+          continue;// s is updated by the failed CAS.
+        }
+        if ((s & IN_FLIGHT) == 0)
+          break;// FREE
+      }
+      // the request CAPACITY before is in flight.
+      if ((s & WAITING) == 0 &&
+          !slot.state.compare_exchange_weak(s, s | WAITING,
+                                            std::memory_order_acq_rel))
+        continue;// s is updated by the failed CAS.
+      internal::futex_wait(&slot.state, s | WAITING);
+      s = slot.state.load(std::memory_order_acquire);
     }
-    this->cond.wait(lock);
+    auto old = slot.state.exchange(tagOf(id) | PENDING | RINGED,
+                                   std::memory_order_acq_rel);
+    // wake threads waiting for the request moved out, or for this one
+    // before the slot was acquired.
+    if (old & WAITING)
+      internal::futex_wake(&slot.state);
+    auto cmd = this->get(id);
+    cmd->setID(id);
+    cmd->setCallback(nullptr, nullptr);
+  }
+  return this->get(msgid);
+}
+
+/**
+ * @brief store a completed command
+ * @param cmd a pointer to a command completed
+ *
+ * Only threads waiting for the request are woken up.
+ * The result of a command with a callback or of an internal command is
+ * not kept, because nobody picks it up (see Command::keepsResult()).
+ * The command can be reused as soon as it is out of the request queue.
+ */
+void CompletionTable::push(Command *cmd)
+{
+  auto msgid = cmd->getID();
+  Slot &slot = this->slots[msgid & MASK];
+  uint32_t phase = cmd->keepsResult() ? DONE : FREE;
+  slot.status = cmd->getStatus();
+  slot.retval = cmd->getRetval();
+  // a cancelled command is left in the request queue.
+  auto old = slot.state.load(std::memory_order_relaxed);
+  while (!slot.state.compare_exchange_weak(old,
+           tagOf(msgid) | (old & RINGED) | phase, std::memory_order_acq_rel))
+    ;// old is updated by the failed CAS.
+  if (old & WAITING)
+    internal::futex_wake(&slot.state);
+  notifier.notify();
+}
+
+/**
+ * @brief mark a command cancellable
+ * @param cmd a pointer to a command filled and about to be pushed
+ *
+ * This must be called before the command is published to the pseudo
+ * thread. The WAITING flag is kept.
+ */
+void CompletionTable::markQueued(Command *cmd)
+{
+  Slot &slot = this->slots[cmd->getID() & MASK];
+  slot.state.fetch_and(~(PENDING ^ QUEUED), std::memory_order_release);
+}
+
+/**
+ * @brief claim a command popped from the request queue to execute it
+ * @param cmd a pointer to a command popped
+ * @return true if the command is to be executed; false if cancelled.
+ *
+ * Only the pseudo thread calls this function. The slot cannot be reused
+ * while the command is in the request queue, so the tag always matches.
+ * The command is marked out of the request queue; a cancelled command
+ * can be reused at once, so that it is not read after that.
+ */
+bool CompletionTable::start(Command *cmd)
+{
+  Slot &slot = this->slots[cmd->getID() & MASK];
+  bool cancellable = cmd->isCancellable();
+  auto s = slot.state.fetch_and(~RINGED, std::memory_order_acq_rel);
+  // wake threads waiting to reuse the slot of a cancelled command.
+  if ((s & WAITING) && (s & PHASE_MASK) != PENDING
+      && (s & PHASE_MASK) != QUEUED)
+    internal::futex_wake(&slot.state);
+  if (!cancellable)
+    return true;
+  // a command claimed by cancel() is PENDING until it completes;
+  // only a QUEUED command can be started.
+  s &= ~RINGED;
+  while ((s & PHASE_MASK) == QUEUED) {
+    if (slot.state.compare_exchange_weak(s, s | PENDING,
+                                         std::memory_order_acq_rel))
+      return true;
+    // s is updated by the failed CAS.
+  }
+  return false;// cancelled
+}
+
+/**
+ * @brief claim a command not started yet to cancel it
+ * @param msgid request ID
+ * @return true if the command is claimed; the caller must complete it.
+ */
+bool CompletionTable::cancel(uint64_t msgid)
+{
+  Slot &slot = this->slots[msgid & MASK];
+  auto s = slot.state.load(std::memory_order_acquire);
+  for (;;) {
+    if ((s & TAG_MASK) != tagOf(msgid) || (s & PHASE_MASK) != QUEUED)
+      return false;// started, finished or not pushed yet
+    if (slot.state.compare_exchange_weak(s, s | PENDING,
+                                         std::memory_order_acq_rel))
+      return true;
+    // s is updated by the failed CAS.
   }
 }
 
 /**
- * @brief try to find a command with the specified message ID
+ * @brief claim the command of a slot if it is not started yet
+ * @param index index of the slot
+ * @return the command claimed; the caller must complete it.
+ *         nullptr if the slot has no command to be cancelled.
+ *
+ * The command of a QUEUED slot is in use by the request of the slot,
+ * whose ID has the index in the low bits.
+ */
+Command *CompletionTable::cancelAt(size_t index)
+{
+  Slot &slot = this->slots[index];
+  auto s = slot.state.load(std::memory_order_acquire);
+  while ((s & PHASE_MASK) == QUEUED) {
+    if (slot.state.compare_exchange_weak(s, s | PENDING,
+                                         std::memory_order_acq_rel))
+      return this->get(index);
+    // s is updated by the failed CAS.
+  }
+  return nullptr;
+}
+
+/**
+ * @brief try to pick up the result of a request
  * @param msgid a message ID to find
- * @return a pointer to a command with the specified message ID;
- *         nullptr if a command with the message ID is not found in the queue.
+ * @param[out] status the status of the command; VEO_COMMAND_ERROR if
+ *             the result has already been picked up.
+ * @param[out] retp pointer to buffer to store the return value
+ * @param[in,out] s the state of the slot loaded; updated on failure.
+ * @retval true the status is set.
+ * @retval false the command has not completed yet.
  *
- * This function is expected to be called from a thread holding lock.
+ * The result is picked up by CAS on the state of the slot, so that only
+ * one thread gets it; the table is never locked.
  */
-CmdPtr BlockingQueue::tryFindNoLock(uint64_t msgid) {
-  for (auto &&it = this->queue.begin(); it != this->queue.end(); ++it) {
-    if ((*it)->getID() == msgid) {
-      auto rv = std::move(*it);
-      this->queue.erase(it);
-      return rv;
+bool CompletionTable::tryPickUp(uint64_t msgid, int &status, uint64_t *retp,
+                                uint32_t &s)
+{
+  Slot &slot = this->slots[msgid & MASK];
+  for (;;) {
+    auto diff = (tagOf(msgid) - (s & TAG_MASK)) & TAG_MASK;
+    if (diff != 0) {
+      // An older tag means that the slot is not acquired for the request
+      // yet; a newer one means that the result has been picked up or
+      // moved to the overflow map on reuse of the slot.
+      if (diff < TAG_MASK / 2)
+        return false;
+      if (!this->takeOverflow(msgid, status, retp))
+        status = VEO_COMMAND_ERROR;
+      return true;
+    }
+    switch (s & PHASE_MASK) {
+    case QUEUED:
+    case PENDING:
+      return false;
+    case DONE: {
+      // read the result before releasing the slot; the CAS fails if
+      // the slot has been reused meanwhile.
+      auto retval = slot.retval;
+      auto st = slot.status;
+      auto picked = (s & (TAG_MASK | RINGED)) | FREE;
+      if (slot.state.compare_exchange_weak(s, picked,
+                                           std::memory_order_acq_rel)) {
+        if (s & WAITING)
+          internal::futex_wake(&slot.state);
+        *retp = retval;
+        status = st;
+        return true;
+      }
+      continue;// s is updated by the failed CAS.
+    }
+    default:
+      status = VEO_COMMAND_ERROR;// already picked up
+      return true;
     }
   }
-  return nullptr;
 }
 
-CmdPtr BlockingQueue::tryFind(uint64_t msgid) {
-  std::lock_guard<std::mutex> lock(this->mtx);
-  return this->tryFindNoLock(msgid);
+/**
+ * @brief try to pick up the result of a request
+ * @param msgid a message ID to find
+ * @param[out] retp pointer to buffer to store the return value
+ * @return the status of the command; VEO_COMMAND_UNFINISHED if not
+ *         completed yet; VEO_COMMAND_ERROR if the result has already been
+ *         picked up.
+ */
+int CompletionTable::tryFind(uint64_t msgid, uint64_t *retp)
+{
+  auto s = this->slots[msgid & MASK].state.load(std::memory_order_acquire);
+  int status;
+  if (!this->tryPickUp(msgid, status, retp, s))
+    return VEO_COMMAND_UNFINISHED;
+  return status;
 }
 
-CmdPtr BlockingQueue::wait(uint64_t msgid) {
+/**
+ * @brief sleep until a command with the specified message ID completes
+ * @param msgid a message ID to wait for
+ * @param[out] retp pointer to buffer to store the return value
+ * @param deadline deadline on the monotonic clock in nanoseconds;
+ *        internal::NO_DEADLINE to wait infinitely.
+ * @return the status of the command; VEO_COMMAND_ERROR if the result has
+ *         already been picked up; VEO_COMMAND_UNFINISHED
+ *         if the deadline has passed.
+ */
+int CompletionTable::park(uint64_t msgid, uint64_t *retp, uint64_t deadline)
+{
+  Slot &slot = this->slots[msgid & MASK];
+  auto s = slot.state.load(std::memory_order_acquire);
   for (;;) {
-    std::unique_lock<std::mutex> lock(this->mtx);
-    auto rv = this->tryFindNoLock(msgid);
-    if (rv != nullptr)
-      return rv;
-    this->cond.wait(lock);
+    int status;
+    if (this->tryPickUp(msgid, status, retp, s))
+      return status;
+    struct timespec rel, *timeout = nullptr;
+    if (deadline != internal::NO_DEADLINE) {
+      // The WAITING flag can be left set; it costs only a spurious wake.
+      if (!internal::time_until(deadline, rel))
+        return VEO_COMMAND_UNFINISHED;
+      timeout = &rel;
+    }
+    // mark the slot waited so that the next update of the state wakes us.
+    if ((s & WAITING) == 0 &&
+        !slot.state.compare_exchange_weak(s, s | WAITING,
+                                          std::memory_order_acq_rel))
+      continue;// s is updated by the failed CAS.
+    internal::futex_wait(&slot.state, s | WAITING, timeout);
+    s = slot.state.load(std::memory_order_acquire);
   }
 }
 
-CmdPtr BlockingQueue::popNoWait() {
-    std::unique_lock<std::mutex> lock(this->mtx);
-    if (!this->queue.empty()) {
-      auto command = std::move(this->queue.front());
-      this->queue.pop_front();
+/**
+ * @brief busy-wait for a command with the specified message ID to complete
+ * @param msgid a message ID to wait for
+ * @param until time to stop spinning on the monotonic clock in nanoseconds
+ * @return true if the state of the slot has changed.
+ *
+ * Only the state of the slot is polled.
+ */
+bool CompletionTable::spin(uint64_t msgid, uint64_t until)
+{
+  Slot &slot = this->slots[msgid & MASK];
+  for (uint64_t i = 0; ; ++i) {
+    auto s = slot.state.load(std::memory_order_acquire);
+    if ((s & TAG_MASK) != tagOf(msgid) || (s & IN_FLIGHT) == 0)
+      return true;
+    // read the clock once in a while; pause is much cheaper.
+    if ((i & 15) == 15 && internal::now_ns() >= until)
+      return false;
+    internal::cpu_relax();
+  }
+}
 
-      return command;
-    }
+/**
+ * @brief wait for a command with the specified message ID to complete
+ * @param msgid a message ID to wait for
+ * @param[out] retp pointer to buffer to store the return value
+ * @param timeout_ns timeout in nanoseconds; negative to wait infinitely.
+ * @return the status of the command; VEO_COMMAND_ERROR if the result has
+ *         already been picked up; VEO_COMMAND_UNFINISHED
+ *         upon timeout, leaving the result to be picked up later.
+ *
+ * The calling thread busy-waits and/or sleeps according to the wait
+ * policy of the table. The adaptive policy spins for twice the average
+ * wait time if it is shorter than MAX_SPIN_NS, and parks at once
+ * otherwise; the average is updated by every wait not timed out.
+ */
+int CompletionTable::wait(uint64_t msgid, uint64_t *retp, int64_t timeout_ns)
+{
+  auto deadline = internal::deadline_ns(timeout_ns);
+  switch (this->policy) {
+  case VEO_WAIT_SPIN:
+    this->spin(msgid, deadline);
+    return this->park(msgid, retp, deadline);
+  case VEO_WAIT_ADAPTIVE: {
+    auto start = internal::now_ns();
+    auto est = this->estimate.load(std::memory_order_relaxed);
+    if (2 * est <= MAX_SPIN_NS)
+      this->spin(msgid, std::min(start + 2 * est, deadline));
+    auto status = this->park(msgid, retp, deadline);
+    if (status == VEO_COMMAND_UNFINISHED)
+      return status;
+    int64_t elapsed = internal::now_ns() - start;
+    this->estimate.store(est + (elapsed - static_cast<int64_t>(est)) / 8,
+                         std::memory_order_relaxed);
+    return status;
+  }
+  default:
+    return this->park(msgid, retp, deadline);
+  }
+}
+
+/**
+ * @brief get a command to fill for a new request
+ * @param lane lane to push the request
+ * @return a pointer to a command whose request ID is issued;
+ *         nullptr if the queue is closed.
+ *
+ * The completion slot is acquired before the ticket in the lane is
+ * reserved: acquire() can wait for a request queued in any lane, which
+ * must not be left behind a ticket held by the waiting thread.
+ * The command must be pushed by pushRequest().
+ */
+Command *CommQueue::newRequest(int lane)
+{
+  if (this->queue_state.load() != VEO_QUEUE_READY)
     return nullptr;
+  auto cmd = this->completion.acquire(
+               this->next_id.fetch_add(1, std::memory_order_acq_rel));
+  cmd->setTicket(lane, this->request[lane].reserve());
+  return cmd;
 }
 
 /**
  * @brief push a command to request queue
- * @param req a pointer to a command to be pushed (sent)
- * @return zero upon pushing a request; one upon not pushing a request
+ * @param req a pointer to a command got by newRequest()
+ * @return request ID
+ */
+uint64_t CommQueue::pushRequest(Command *req)
+{
+  auto id = req->getID();
+  if (req->isCancellable())
+    this->completion.markQueued(req);
+  this->request[req->getLane()].publish(req->getTicket(), req);
+  this->wakeConsumer();
+  return id;
+}
+
+/**
+ * @brief get commands to fill for consecutive new requests
+ * @param n the number of requests; at most RequestQueue::CAPACITY.
+ * @param lane lane to push the requests
+ * @return the first request ID issued; VEO_REQUEST_ID_INVALID if
+ *         the queue is closed.
+ *
+ * The completion slots are acquired before the tickets are reserved
+ * as newRequest() does. The command of each request is obtained by
+ * getRequest() and all of them must be pushed by pushRequests().
  */
-int CommQueue::pushRequest(std::unique_ptr<Command> req)
+uint64_t CommQueue::newRequests(size_t n, int lane)
 {
-  if( this->request.getStatus() == VEO_QUEUE_READY ){
-    this->request.push(std::move(req));
-    return 0;
+  if (this->queue_state.load() != VEO_QUEUE_READY)
+    return VEO_REQUEST_ID_INVALID;
+  auto first = this->next_id.fetch_add(n, std::memory_order_acq_rel);
+  this->completion.acquire(first, n);
+  auto pos = this->request[lane].reserve(n);
+  for (size_t i = 0; i < n; ++i)
+    this->completion.get(first + i)->setTicket(lane, pos + i);
+  return first;
+}
+
+/**
+ * @brief push consecutive commands to request queue at once
+ * @param first the first request ID got by newRequests()
+ * @param n the number of requests
+ *
+ * The pseudo thread is woken up at most once for the whole batch.
+ */
+void CommQueue::pushRequests(uint64_t first, size_t n)
+{
+  for (size_t i = 0; i < n; ++i) {
+    auto cmd = this->completion.get(first + i);
+    if (cmd->isCancellable())
+      this->completion.markQueued(cmd);
+    this->request[cmd->getLane()].publish(cmd->getTicket(), cmd);
   }
-  return 1;
+  this->wakeConsumer();
 }
 
-std::unique_ptr<Command> CommQueue::popRequest()
+/**
+ * @brief pop a command from the highest-priority lane without blocking
+ * @return a pointer to a command; nullptr if all lanes are empty.
+ *
+ * Cancelled commands are dropped.
+ */
+Command *CommQueue::popNoWait()
 {
-  return this->request.pop();
+  for (int lane = NUM_LANES - 1; lane >= 0; --lane) {
+    for (;;) {
+      auto cmd = this->request[lane].popNoWait();
+      if (cmd == nullptr)
+        break;
+      if (this->completion.start(cmd))
+        return cmd;
+    }
+  }
+  return nullptr;
 }
 
-void CommQueue::pushCompletion(std::unique_ptr<Command> req)
+/**
+ * @brief pop a command from request queue
+ * @return a pointer to a command to be poped (received).
+ *
+ * This function gets the first command in the highest-priority lane.
+ * If all lanes are empty, this function parks until a command is pushed.
+ * Only the pseudo thread can call this function.
+ */
+Command *CommQueue::popRequest()
+{
+  for (;;) {
+    auto cmd = this->popNoWait();
+    if (cmd != nullptr)
+      return cmd;
+    this->consumer_parked.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // check again not to miss a command pushed just before parking.
+    cmd = this->popNoWait();
+    if (cmd != nullptr) {
+      this->consumer_parked.store(0, std::memory_order_relaxed);
+      return cmd;
+    }
+    // a producer clears the flag before waking; EAGAIN and EINTR are
+    // handled by retrying.
+    internal::futex_wait(&this->consumer_parked, 1);
+  }
+}
+
+/**
+ * @brief cancel a command not started yet
+ * @param msgid request ID
+ * @return true if cancelled; false if the command has already started,
+ *         has finished or is not cancellable.
+ *
+ * The command is completed with VEO_COMMAND_CANCELLED by the calling
+ * thread. It stays in the request queue until the pseudo thread drops it.
+ */
+bool CommQueue::cancelRequest(uint64_t msgid)
+{
+  if (msgid >= this->next_id.load(std::memory_order_acquire))
+    return false;
+  if (!this->completion.cancel(msgid))
+    return false;
+  auto cmd = this->completion.get(msgid);
+  cmd->setResult(0, VEO_COMMAND_CANCELLED);
+  this->pushCompletion(cmd);
+  return true;
+}
+
+/**
+ * @brief cancel all commands not started yet
+ * @return the number of commands cancelled
+ *
+ * All slots of the completion table are walked, because a command left
+ * in a lower-priority lane can be older than any window of request IDs.
+ */
+int CommQueue::cancelAll()
 {
-  this->completion.push(std::move(req));
+  int n = 0;
+  for (size_t i = 0; i < CompletionTable::CAPACITY; ++i) {
+    auto cmd = this->completion.cancelAt(i);
+    if (cmd == nullptr)
+      continue;
+    cmd->setResult(0, VEO_COMMAND_CANCELLED);
+    this->pushCompletion(cmd);
+    ++n;
+  }
+  return n;
 }
 
-std::unique_ptr<Command> CommQueue::peekCompletion(uint64_t msgid)
+/**
+ * @brief wake the pseudo thread if it is parking
+ */
+void CommQueue::wakeConsumer()
 {
-  return this->completion.tryFind(msgid);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (this->consumer_parked.load(std::memory_order_relaxed) != 0 &&
+      this->consumer_parked.exchange(0) != 0)
+    internal::futex_wake(&this->consumer_parked, 1);
 }
 
-std::unique_ptr<Command> CommQueue::waitCompletion(uint64_t msgid)
+/**
+ * @brief release resources owned by a command
+ *
+ * A snapshot of arguments owned by a call is deleted.
+ * The command must not be executed after this.
+ */
+void Command::release()
 {
-  return this->completion.wait(msgid);
+  if (this->type == VEO_COMMAND_TYPE_CALL && this->param.call.owned) {
+    delete this->param.call.args;
+    this->param.call.args = nullptr;
+    this->param.call.owned = false;
+  }
 }
 
+/**
+ * @brief push a completed command
+ * @param req a pointer to a command completed
+ *
+ * If a callback is set to the command, the result is posted to
+ * the executor to run the callback. Resources owned by the command
+ * are released before the slot can be reused.
+ */
+void CommQueue::pushCompletion(Command *req)
+{
+  req->release();
+  if (req->callback.func != nullptr) {
+    Completion c = {this->owner, req->getID(), req->getStatus(),
+                    req->getRetval(), req->callback.func, req->callback.arg};
+    this->executor->post(c);
+  }
+  this->completion.push(req);
+  int fd = this->event_fd.load(std::memory_order_acquire);
+  if (fd >= 0) {
+    uint64_t one = 1;
+    // EAGAIN on overflow of the counter is harmless: it stays readable.
+    auto rv = write(fd, &one, sizeof(one));
+    (void)rv;
+  }
+}
+
+CommQueue::~CommQueue()
+{
+  int fd = this->event_fd.load();
+  if (fd >= 0)
+    ::close(fd);
+}
+
+/**
+ * @brief get the eventfd signalled on completion of commands
+ * @return file descriptor; -1 upon failure.
+ *
+ * The eventfd is created on the first call. After it is created,
+ * every completion adds one to its counter after the result is stored,
+ * so that the results are available once the counter is read.
+ */
+int CommQueue::getCompletionFd()
+{
+  int fd = this->event_fd.load(std::memory_order_acquire);
+  if (fd >= 0)
+    return fd;
+  int newfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (newfd < 0)
+    return -1;
+  if (!this->event_fd.compare_exchange_strong(fd, newfd)) {
+    // another thread has created one.
+    ::close(newfd);
+    return fd;
+  }
+  return newfd;
+}
+
+/**
+ * @brief pick up the result of a command if available
+ * @param msgid request ID
+ * @param[out] retp pointer to buffer to store the return value
+ * @return the status of the command; VEO_COMMAND_UNFINISHED if not
+ *         completed yet; VEO_COMMAND_ERROR if msgid is not outstanding.
+ */
+int CommQueue::peekCompletion(uint64_t msgid, uint64_t *retp)
+{
+  if (msgid >= this->next_id.load(std::memory_order_acquire))
+    return VEO_COMMAND_ERROR;
+  return this->completion.tryFind(msgid, retp);
+}
+
+/**
+ * @brief wait for completion of a command
+ * @param msgid request ID
+ * @param[out] retp pointer to buffer to store the return value
+ * @param timeout_ns timeout in nanoseconds; negative to wait infinitely.
+ * @return the status of the command; VEO_COMMAND_ERROR if msgid is not
+ *         outstanding; VEO_COMMAND_UNFINISHED upon timeout.
+ */
+int CommQueue::waitCompletion(uint64_t msgid, uint64_t *retp,
+                              int64_t timeout_ns)
+{
+  if (msgid >= this->next_id.load(std::memory_order_acquire))
+    return VEO_COMMAND_ERROR;
+  return this->completion.wait(msgid, retp, timeout_ns);
+}
+
+/**
+ * @brief complete all commands left in request queue as unfinished
+ *
+ * Events recorded by the commands are signalled not to block waiters
+ * on other contexts forever.
+ */
 void CommQueue::setCompletion()
 {
   for(;;) {
-    auto command = this->request.popNoWait();
+    auto command = this->popNoWait();
     if ( command == nullptr )
       return;
+    if (command->getType() == VEO_COMMAND_TYPE_RECORD_EVENT)
+      command->param.event.ev->signal(command->param.event.target);
     command->setResult(0, VEO_COMMAND_UNFINISHED);
-    this->completion.push(std::move(command));
+    this->pushCompletion(command);
   }
 }
 } // namespace veo
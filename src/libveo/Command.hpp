@@ -7,80 +7,440 @@
  */
 #ifndef _VEO_COMMAND_HPP_
 #define _VEO_COMMAND_HPP_
-#include <queue>
-#include <memory>
 #include <mutex>
-#include <condition_variable>
 #include <atomic>
+#include <cstddef>
+#include <ctime>
+#include <unordered_map>
 #include "ve_offload.h"
+#include "CallArgs.hpp"
 namespace veo {
 class ThreadContext;
+class ProcHandle;
+class CallArgs;
+class CompletionExecutor;
+class Event;
+class Graph;
+class CallPlan;
 
 typedef enum veo_command_state CommandStatus;
 typedef enum veo_queue_state QueueStatus;
 
 /**
- * @brief base class of command handled by pseudo thread
+ * @brief type of command handled by pseudo thread
+ */
+enum CommandType {
+  VEO_COMMAND_TYPE_CALL = 0,//!< call a VE function
+  VEO_COMMAND_TYPE_READ_MEM,//!< read VE memory
+  VEO_COMMAND_TYPE_WRITE_MEM,//!< write VE memory
+  VEO_COMMAND_TYPE_CALL_VH,//!< call a VH function
+  VEO_COMMAND_TYPE_LAUNCH_GRAPH,//!< replay a graph
+  VEO_COMMAND_TYPE_LAUNCH_PLAN,//!< call a VE function by a call plan
+  VEO_COMMAND_TYPE_OPEN_CONTEXT,//!< create a VE thread for a new context
+  VEO_COMMAND_TYPE_EXIT,//!< terminate the VE process
+  VEO_COMMAND_TYPE_CLOSE,//!< terminate the pseudo thread
+  VEO_COMMAND_TYPE_RECORD_EVENT,//!< signal an event
+  VEO_COMMAND_TYPE_WAIT_EVENT,//!< wait for an event
+};
+
+/**
+ * @brief command handled by pseudo thread
  *
- * a command is to be implemented as a function object inheriting Command
- * (see CommandImpl in ThreadContext.cpp).
+ * A command is a fixed-size object holding the parameters of its type.
+ * Commands are kept in the completion table of a context and reused,
+ * so that submitting a command does not allocate memory.
+ * The pseudo thread dispatches a command by its type
+ * (see ThreadContext::handleCommand()).
  */
 class Command {
 private:
   uint64_t msgid;/*! message ID */
   uint64_t retval;/*! returned value from the function on VE */
   int status;
+  CommandType type;
+  uint64_t ticket;/*! ticket in the request queue of the lane */
+  int lane;/*! lane of the request queue (enum veo_request_priority) */
 
 public:
-  explicit Command(uint64_t id): msgid(id) {}
-  Command() = delete;
+  /**
+   * @brief parameters of command
+   */
+  union {
+    struct {
+      uint64_t addr;//!< VEMVA of function
+      CallArgs *args;//!< arguments of function
+      ProcHandle *proc;//!< process to open context (OPEN_CONTEXT only)
+      CallPlan *plan;//!< plan of the call (LAUNCH_PLAN only)
+      bool owned;//!< args deleted on completion (CALL only)
+      bool prepared;//!< marshalled on submission (CALL only)
+      uint64_t sp;//!< stack pointer marshalled for if prepared
+    } call;
+    struct {
+      void *dst;
+      uint64_t src;
+      size_t size;
+    } read;
+    struct {
+      uint64_t dst;
+      const void *src;
+      size_t size;
+    } write;
+    struct {
+      uint64_t (*func)(void *);
+      void *arg;
+    } vh;
+    struct {
+      Graph *graph;
+    } graph;
+    struct {
+      Event *ev;
+      uint32_t target;//!< number of the record
+    } event;
+  } param;
+  /**
+   * @brief callback on completion; func is nullptr if not set.
+   */
+  struct {
+    veo_completion_cb func;
+    void *arg;
+  } callback;
+
+  Command(): msgid(VEO_REQUEST_ID_INVALID) { this->setCallback(nullptr, nullptr); }
   Command(const Command &) = delete;
-  virtual int operator()() = 0;
   void setResult(uint64_t r, int s) { this->retval = r; this->status = s; }
+  void setID(uint64_t id) { this->msgid = id; }
   uint64_t getID() { return this->msgid; }
   int getStatus() { return this->status; }
   uint64_t getRetval() { return this->retval; }
+  CommandType getType() { return this->type; }
+  void setTicket(int l, uint64_t t) { this->lane = l; this->ticket = t; }
+  int getLane() { return this->lane; }
+  uint64_t getTicket() { return this->ticket; }
+  /**
+   * @brief whether the command can be cancelled before it starts
+   *
+   * Commands managing contexts, processes and events are not
+   * cancellable.
+   */
+  bool isCancellable() {
+    return this->type <= VEO_COMMAND_TYPE_LAUNCH_PLAN;
+  }
+  /**
+   * @brief whether the result is kept until it is picked up
+   *
+   * The result of a command with a callback is passed to the callback.
+   * Commands recording and waiting for events are internal; their
+   * request IDs are not returned to the caller.
+   */
+  bool keepsResult() {
+    return this->callback.func == nullptr
+      && this->type != VEO_COMMAND_TYPE_RECORD_EVENT
+      && this->type != VEO_COMMAND_TYPE_WAIT_EVENT;
+  }
+
+  void setCall(uint64_t addr, CallArgs *args, bool owned = false) {
+    this->type = VEO_COMMAND_TYPE_CALL;
+    this->param.call.addr = addr;
+    this->param.call.args = args;
+    this->param.call.owned = owned;
+    this->param.call.prepared = false;
+  }
+  void release();
+  void setReadMem(void *dst, uint64_t src, size_t size) {
+    this->type = VEO_COMMAND_TYPE_READ_MEM;
+    this->param.read.dst = dst;
+    this->param.read.src = src;
+    this->param.read.size = size;
+  }
+  void setWriteMem(uint64_t dst, const void *src, size_t size) {
+    this->type = VEO_COMMAND_TYPE_WRITE_MEM;
+    this->param.write.dst = dst;
+    this->param.write.src = src;
+    this->param.write.size = size;
+  }
+  void setCallVH(uint64_t (*func)(void *), void *arg) {
+    this->type = VEO_COMMAND_TYPE_CALL_VH;
+    this->param.vh.func = func;
+    this->param.vh.arg = arg;
+  }
+  void setOpenContext(ProcHandle *proc, uint64_t addr, CallArgs *args) {
+    this->type = VEO_COMMAND_TYPE_OPEN_CONTEXT;
+    this->param.call.addr = addr;
+    this->param.call.args = args;
+    this->param.call.proc = proc;
+    this->param.call.prepared = false;
+  }
+  void setExit(uint64_t addr, CallArgs *args) {
+    this->type = VEO_COMMAND_TYPE_EXIT;
+    this->param.call.addr = addr;
+    this->param.call.args = args;
+    this->param.call.prepared = false;
+  }
+  void setClose() { this->type = VEO_COMMAND_TYPE_CLOSE; }
+  void setLaunchGraph(Graph *g) {
+    this->type = VEO_COMMAND_TYPE_LAUNCH_GRAPH;
+    this->param.graph.graph = g;
+  }
+  void setLaunchPlan(uint64_t addr, CallArgs *args, CallPlan *plan) {
+    this->type = VEO_COMMAND_TYPE_LAUNCH_PLAN;
+    this->param.call.addr = addr;
+    this->param.call.args = args;
+    this->param.call.plan = plan;
+    this->param.call.prepared = false;
+  }
+  void setRecordEvent(Event *ev, uint32_t target) {
+    this->type = VEO_COMMAND_TYPE_RECORD_EVENT;
+    this->param.event.ev = ev;
+    this->param.event.target = target;
+  }
+  void setWaitEvent(Event *ev, uint32_t target) {
+    this->type = VEO_COMMAND_TYPE_WAIT_EVENT;
+    this->param.event.ev = ev;
+    this->param.event.target = target;
+  }
+  void setCallback(veo_completion_cb func, void *arg) {
+    this->callback.func = func;
+    this->callback.arg = arg;
+  }
 };
 
 /**
- * @brief blocking queue used in CommQueue
+ * @brief bounded lock-free multi-producer/single-consumer request queue
+ *
+ * Any host thread can push a command while the pseudo thread, the only
+ * consumer, pops commands in the order of the tickets the producers
+ * reserved. A producer reserves a ticket by CAS on the tail, fills
+ * the command and then publishes it by storing the sequence number of
+ * the slot.
+ * A producer parks only when the ring is full. Parking of the pseudo
+ * thread is up to the owner (see CommQueue::popRequest()), so that
+ * the pseudo thread can wait for several queues.
  */
-class BlockingQueue {
+class RequestQueue {
+public:
+  static constexpr size_t CAPACITY = 4096;//!< the number of slots
 private:
-  std::mutex mtx;
-  std::condition_variable cond;
-  std::deque<std::unique_ptr<Command> > queue;
-  std::unique_ptr<Command> tryFindNoLock(uint64_t);
-  std::atomic<QueueStatus> queue_state;
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0,
+                "CAPACITY must be a power of two");
+  static constexpr uint64_t MASK = CAPACITY - 1;
+  static constexpr size_t CACHE_LINE = 64;
+  struct Slot {
+    std::atomic<uint64_t> seq;/*! ticket + 1 when published */
+    Command *cmd;
+  };
+  Slot ring[CAPACITY];
+  std::atomic<uint64_t> tail;/*! next ticket to reserve (producers) */
+  char pad_tail_[CACHE_LINE - sizeof(std::atomic<uint64_t>)];
+  std::atomic<uint64_t> head;/*! next ticket to pop (consumer) */
+  char pad_head_[CACHE_LINE - sizeof(std::atomic<uint64_t>)];
+  std::atomic<uint32_t> space;/*! futex: bumped when a slot is freed */
+  std::atomic<uint32_t> producers_parked;/*! producers waiting for space */
+
+  void waitForSpace(uint64_t);
+  void wakeProducers();
+
+public:
+  RequestQueue();
+  RequestQueue(const RequestQueue &) = delete;
+  uint64_t reserve(size_t n = 1);
+  void publish(uint64_t, Command *);
+  Command *popNoWait();
+};
+
+/**
+ * @brief notifier of completions shared by all contexts
+ *
+ * A thread waiting for any of requests on several contexts sleeps on
+ * the epoch of the notifier, which is bumped on every completion while
+ * such a thread exists. Completions cost one fence and one load when
+ * nobody is waiting on the notifier.
+ */
+class CompletionNotifier {
+private:
+  std::atomic<uint32_t> epoch;/*! futex: bumped on completion if waited */
+  std::atomic<uint32_t> waiters;/*! the number of threads waiting */
+public:
+  CompletionNotifier(): epoch(0), waiters(0) {}
+  CompletionNotifier(const CompletionNotifier &) = delete;
+  void notify();
+  uint32_t prepare();
+  void wait(uint32_t, const struct timespec *);
+  void finish();
+};
+
+/**
+ * @brief table of commands and results indexed by request ID
+ *
+ * The table is the slab of commands of a context and keeps the results
+ * of requests: a request ID encodes the index of its result slot in
+ * the low bits and the generation of the slot in the high bits.
+ * The result of a request is kept in the slot until it is picked up.
+ * If the slot is reused by the request CAPACITY later before that,
+ * the result is moved to the overflow map, which is locked only while
+ * it is not empty.
+ * Commands are only needed while requests are in flight, so that
+ * they are kept in a smaller array of COMMANDS entries indexed by
+ * the low bits of request IDs. The command of a request is not reused
+ * until the request COMMANDS before has finished and left the request
+ * queue. A result slot takes 16 bytes and a command about 100 bytes.
+ *
+ * Each slot has a 32-bit state word holding the generation tag, the phase
+ * (FREE, PENDING, QUEUED or DONE), a WAITING flag and a RINGED flag set
+ * while the command is in a request queue. A slot is not reused until
+ * the request CAPACITY before has finished and left the request queue;
+ * it can be left behind, e.g. in a lower-priority lane, by any number of
+ * requests issued later. A cancellable
+ * command is QUEUED while it waits in the request queue; either the pseudo
+ * thread starting it or a thread cancelling it moves it to PENDING by CAS,
+ * so that exactly one of them completes the command. Checking a request costs one
+ * atomic load and picking up a result one CAS; nothing is locked.
+ * A thread waiting for a request sleeps on the state word as a futex,
+ * so that a completion wakes only the threads waiting for it.
+ */
+class CompletionTable {
+public:
+  static constexpr size_t CAPACITY = 16384;//!< the number of slots
+  /**
+   * @brief the number of commands
+   *
+   * A batch of requests up to the capacity of a request queue does not
+   * wait for a command in use by the batch itself.
+   */
+  static constexpr size_t COMMANDS = RequestQueue::CAPACITY;
+  static constexpr uint64_t MAX_SPIN_NS = 100000;//!< adaptive spin limit
+  static constexpr uint64_t INITIAL_ESTIMATE_NS = 10000;
+private:
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0,
+                "CAPACITY must be a power of two");
+  static_assert((COMMANDS & (COMMANDS - 1)) == 0 && COMMANDS <= CAPACITY,
+                "COMMANDS must be a power of two up to CAPACITY");
+  static constexpr uint64_t MASK = CAPACITY - 1;
+  static constexpr uint64_t COMMAND_MASK = COMMANDS - 1;
+  static constexpr int INDEX_BITS = 14;
+  static_assert(CAPACITY == 1UL << INDEX_BITS, "INDEX_BITS mismatch");
+  // layout of the state word
+  static constexpr uint32_t PHASE_MASK = 0x3;
+  static constexpr uint32_t FREE = 0x0;//!< picked up or never used
+  static constexpr uint32_t QUEUED = 0x1;//!< pushed and cancellable
+  static constexpr uint32_t DONE = 0x2;//!< finished, result available
+  static constexpr uint32_t PENDING = 0x3;//!< acquired or started
+  static constexpr uint32_t IN_FLIGHT = 0x1;//!< set in QUEUED and PENDING
+  static constexpr uint32_t WAITING = 0x4;//!< threads sleep on the state
+  static constexpr uint32_t RINGED = 0x8;//!< in a request queue
+  static constexpr uint32_t TAG_SHIFT = 4;
+  static constexpr uint32_t TAG_MASK = ~0U << TAG_SHIFT;
+  /**
+   * @brief generation tag of a request ID placed in the state word
+   */
+  static uint32_t tagOf(uint64_t msgid) {
+    return static_cast<uint32_t>(msgid >> INDEX_BITS) << TAG_SHIFT;
+  }
+  struct Slot {
+    std::atomic<uint32_t> state;/*! futex: tag | WAITING | phase */
+    int status;/*! status of the request if DONE */
+    uint64_t retval;/*! return value of the request if DONE */
+  };
+  Slot slots[CAPACITY];
+  Command cmds[COMMANDS];
+  /**
+   * @brief result of a request moved out of its slot
+   */
+  struct Result {
+    int status;
+    uint64_t retval;
+  };
+  std::mutex overflow_mtx;
+  std::unordered_map<uint64_t, Result> overflow;/*! results by request ID */
+  std::atomic<size_t> num_overflow;/*! the number of results in overflow */
+  static CompletionNotifier notifier;
+  int policy;/*! wait policy (enum veo_wait_policy) */
+  std::atomic<uint64_t> estimate;/*! average wait time in ns (adaptive) */
+  bool moveToOverflow(Slot &, uint64_t, uint32_t &);
+  void waitCommand(uint64_t);
+  bool takeOverflow(uint64_t, int &, uint64_t *);
+  bool tryPickUp(uint64_t, int &, uint64_t *, uint32_t &);
+  int park(uint64_t, uint64_t *, uint64_t);
+  bool spin(uint64_t, uint64_t);
 
 public:
-  BlockingQueue() : queue_state(VEO_QUEUE_READY) {}
-  void push(std::unique_ptr<Command>);
-  std::unique_ptr<Command> pop();
-  std::unique_ptr<Command> tryFind(uint64_t);
-  std::unique_ptr<Command> wait(uint64_t);
-  std::unique_ptr<Command> popNoWait();
-  void setStatus(QueueStatus s) { this->queue_state.store(s); }
-  QueueStatus getStatus() { return this->queue_state.load(); }
+  CompletionTable();
+  CompletionTable(const CompletionTable &) = delete;
+  Command *acquire(uint64_t, size_t n = 1);
+  /**
+   * @brief the command of a request in flight
+   */
+  Command *get(uint64_t msgid) { return &this->cmds[msgid & COMMAND_MASK]; }
+  void push(Command *);
+  void markQueued(Command *);
+  bool start(Command *);
+  bool cancel(uint64_t);
+  Command *cancelAt(size_t);
+  int tryFind(uint64_t, uint64_t *);
+  int wait(uint64_t, uint64_t *, int64_t timeout_ns = -1);
+  void setWaitPolicy(int p) { this->policy = p; }
+  int getWaitPolicy() { return this->policy; }
+  static CompletionNotifier &anyNotifier() { return notifier; }
 };
 
 /**
  * @brief communication queue pair between main thread and pseudo thread
+ *
+ * Requests are pushed to one of the lanes by priority. The pseudo thread
+ * pops commands from the highest-priority lane that is not empty, so that
+ * commands are executed in the order of submission within each lane.
+ * Request IDs are issued from one counter of the context. A new request
+ * waits for its command and completion slot while the request
+ * CompletionTable::COMMANDS or CAPACITY before is still in flight, and
+ * then reserves a slot in the lane, so that no thread waits for them
+ * holding a ticket not published.
+ * A cancelled command is completed by the cancelling thread and skipped
+ * when the pseudo thread pops it.
  */
 class CommQueue {
+public:
+  static constexpr int NUM_LANES = VEO_PRIO_HIGH + 1;//!< the number of lanes
 private:
-  BlockingQueue request;/*! request queue: main -> pseudo */
-  BlockingQueue completion;/*! completion queue: pseudo -> main */
+  RequestQueue request[NUM_LANES];/*! request queues: main -> pseudo */
+  CompletionTable completion;/*! completion table: pseudo -> main */
+  std::atomic<uint64_t> next_id;/*! request ID to issue next */
+  std::atomic<uint32_t> consumer_parked;/*! futex: pseudo thread sleeping */
+  std::atomic<QueueStatus> queue_state;
+  CompletionExecutor *executor;/*! executor of callbacks */
+  veo_thr_ctxt *owner;/*! context passed to callbacks */
+  std::atomic<int> event_fd;/*! eventfd signalled on completion; -1 if none */
+  Command *popNoWait();
+  void wakeConsumer();
 public:
-  CommQueue() {};
+  CommQueue(): next_id(0), consumer_parked(0),
+    queue_state(VEO_QUEUE_READY), executor(nullptr), owner(nullptr),
+    event_fd(-1) {};
+  ~CommQueue();
+  /**
+   * @brief set the executor to run callbacks of commands
+   * @param e executor
+   * @param ctx context passed to callbacks
+   */
+  void setExecutor(CompletionExecutor *e, veo_thr_ctxt *ctx) {
+    this->executor = e;
+    this->owner = ctx;
+  }
 
-  int pushRequest(std::unique_ptr<Command>);
-  std::unique_ptr<Command> popRequest();
-  void pushCompletion(std::unique_ptr<Command>);
-  std::unique_ptr<Command> waitCompletion(uint64_t msgid);
-  std::unique_ptr<Command> peekCompletion(uint64_t msgid);
+  Command *newRequest(int lane = VEO_PRIO_NORMAL);
+  uint64_t pushRequest(Command *);
+  uint64_t newRequests(size_t, int lane = VEO_PRIO_NORMAL);
+  Command *getRequest(uint64_t msgid) { return this->completion.get(msgid); }
+  void pushRequests(uint64_t, size_t);
+  Command *popRequest();
+  bool cancelRequest(uint64_t);
+  int cancelAll();
+  void pushCompletion(Command *);
+  int waitCompletion(uint64_t msgid, uint64_t *, int64_t timeout_ns = -1);
+  int peekCompletion(uint64_t msgid, uint64_t *);
   void setCompletion();
-  void setRequestStatus(QueueStatus s){ this->request.setStatus(s); }
+  int getCompletionFd();
+  void setWaitPolicy(int p) { this->completion.setWaitPolicy(p); }
+  int getWaitPolicy() { return this->completion.getWaitPolicy(); }
+  void setRequestStatus(QueueStatus s){ this->queue_state.store(s); }
 };
 } // namespace veo
 #endif
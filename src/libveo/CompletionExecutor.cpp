@@ -0,0 +1,75 @@
+/**
+ * @file CompletionExecutor.cpp
+ * @brief implementation of executor of completion callbacks
+ */
+#include "CompletionExecutor.hpp"
+
+namespace veo {
+/**
+ * @brief destructor
+ *
+ * The executor thread runs the callbacks already posted and exits.
+ */
+CompletionExecutor::~CompletionExecutor()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->stopping = true;
+  }
+  this->not_empty.notify_one();
+  if (this->thread.joinable())
+    this->thread.join();
+}
+
+/**
+ * @brief post a completion to run its callback
+ * @param c completion of a request whose callback is set
+ *
+ * The completion goes to the overflow list while the ring is full or
+ * the list has older completions, to keep the order of posts.
+ */
+void CompletionExecutor::post(const Completion &c)
+{
+  std::call_once(this->started, [this] {
+    this->thread = std::thread(&CompletionExecutor::run, this);
+  });
+  {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (this->count < CAPACITY && this->overflow.empty()) {
+      this->ring[(this->head + this->count) % CAPACITY] = c;
+      ++this->count;
+    } else {
+      this->overflow.push_back(c);
+    }
+  }
+  this->not_empty.notify_one();
+}
+
+/**
+ * @brief main loop of the executor thread
+ */
+void CompletionExecutor::run()
+{
+  std::unique_lock<std::mutex> lock(this->mtx);
+  for (;;) {
+    this->not_empty.wait(lock, [this]{
+      return this->count > 0 || !this->overflow.empty() || this->stopping;
+    });
+    Completion c;
+    if (this->count > 0) {
+      // the ring has the oldest completions.
+      c = this->ring[this->head];
+      this->head = (this->head + 1) % CAPACITY;
+      --this->count;
+    } else if (!this->overflow.empty()) {
+      c = this->overflow.front();
+      this->overflow.pop_front();
+    } else {
+      return;// stopping
+    }
+    lock.unlock();
+    c.func(c.ctx, c.reqid, c.status, c.retval, c.arg);
+    lock.lock();
+  }
+}
+} // namespace veo
@@ -0,0 +1,66 @@
+/**
+ * @file CompletionExecutor.hpp
+ * @brief executor of completion callbacks
+ *
+ * @internal
+ * @author VEO
+ */
+#ifndef _VEO_COMPLETION_EXECUTOR_HPP_
+#define _VEO_COMPLETION_EXECUTOR_HPP_
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <cstddef>
+#include "ve_offload.h"
+
+namespace veo {
+/**
+ * @brief completion of a request to be passed to its callback
+ */
+struct Completion {
+  veo_thr_ctxt *ctx;
+  uint64_t reqid;
+  int status;
+  uint64_t retval;
+  veo_completion_cb func;
+  void *arg;
+};
+
+/**
+ * @brief thread running callbacks of completed requests
+ *
+ * A process handle owns an executor shared by its contexts. Pseudo
+ * threads post completions and go back to the next command at once;
+ * the executor thread, started on the first post, invokes callbacks
+ * in the order of posts. Completions are kept in a fixed-size ring and,
+ * while it is full, in an overflow list, so that post() never blocks.
+ * A callback, a future continuation or a resumed coroutine on the
+ * executor thread can thus submit requests with callbacks without
+ * stalling the pseudo thread that completes them; it still must not
+ * wait for another request with a callback.
+ */
+class CompletionExecutor {
+public:
+  static constexpr size_t CAPACITY = 4096;//!< the number of entries
+private:
+  std::mutex mtx;
+  std::condition_variable not_empty;
+  Completion ring[CAPACITY];
+  size_t head;/*! index of the first completion */
+  size_t count;/*! the number of completions in the ring */
+  std::deque<Completion> overflow;/*! completions posted after the ring */
+  bool stopping;
+  std::once_flag started;
+  std::thread thread;
+
+  void run();
+
+public:
+  CompletionExecutor(): head(0), count(0), stopping(false) {}
+  ~CompletionExecutor();
+  CompletionExecutor(const CompletionExecutor &) = delete;
+  void post(const Completion &);
+};
+} // namespace veo
+#endif
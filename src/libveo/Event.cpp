@@ -0,0 +1,151 @@
+/**
+ * @file Event.cpp
+ * @brief implementation of events ordering requests across contexts
+ */
+#include "Event.hpp"
+#include "Futex.hpp"
+#include "ThreadContext.hpp"
+#include "log.hpp"
+
+namespace veo {
+/**
+ * @brief issue the number of a new record
+ * @param ctx context to record the event on
+ * @param[out] target number of the record
+ * @return true upon success; false if the last record is on another
+ *         context and has not been reached yet.
+ */
+bool Event::newRecord(ThreadContext *ctx, uint32_t &target)
+{
+  std::lock_guard<std::mutex> lock(this->mtx);
+  auto last = this->recorded.load(std::memory_order_relaxed);
+  if (this->recorder != ctx && !this->isReached(last))
+    return false;
+  this->recorder = ctx;
+  target = last + 1;
+  this->recorded.store(target);
+  return true;
+}
+
+/**
+ * @brief signal that a record of the event is reached
+ * @param target number of the record
+ *
+ * The signalled number never goes back.
+ */
+void Event::signal(uint32_t target)
+{
+  auto s = this->signalled.load(std::memory_order_relaxed);
+  while (!reached(s, target)) {
+    if (this->signalled.compare_exchange_weak(s, target,
+                                              std::memory_order_release))
+      break;
+    // s is updated by the failed CAS.
+  }
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (this->waiters.load(std::memory_order_relaxed) != 0)
+    internal::futex_wake(&this->signalled);
+}
+
+/**
+ * @brief sleep until a record of the event is reached
+ * @param target number of the record
+ */
+void Event::wait(uint32_t target)
+{
+  for (;;) {
+    auto s = this->signalled.load(std::memory_order_acquire);
+    if (reached(s, target))
+      return;
+    this->waiters.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // check again not to miss a signal just before sleeping.
+    if (this->signalled.load(std::memory_order_acquire) == s)
+      internal::futex_wait(&this->signalled, s);
+    this->waiters.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+/**
+ * @brief function to be set to record event request (command)
+ */
+int ThreadContext::_recordEventCommandHandler(Command *cmd)
+{
+  VEO_TRACE(this, "[request #%lu] record event %p (%u)", cmd->getID(),
+            cmd->param.event.ev, cmd->param.event.target);
+  cmd->param.event.ev->signal(cmd->param.event.target);
+  cmd->setResult(0, VEO_COMMAND_OK);
+  return 0;
+}
+
+/**
+ * @brief function to be set to wait event request (command)
+ *
+ * The pseudo thread sleeps and the following commands on this context
+ * wait until the event is reached on the other context.
+ */
+int ThreadContext::_waitEventCommandHandler(Command *cmd)
+{
+  VEO_TRACE(this, "[request #%lu] wait event %p (%u)", cmd->getID(),
+            cmd->param.event.ev, cmd->param.event.target);
+  cmd->param.event.ev->wait(cmd->param.event.target);
+  cmd->setResult(0, VEO_COMMAND_OK);
+  return 0;
+}
+
+/**
+ * @brief record an event after the requests submitted so far
+ *
+ * @param ev event to record
+ * @return zero upon success; -1 upon failure.
+ *
+ * The event is reached when all requests submitted to this context
+ * before it have finished. Events cannot be captured into a graph,
+ * and cannot be recorded while the last record on another context has
+ * not been reached.
+ */
+int ThreadContext::recordEvent(Event *ev)
+{
+  if (this->state == VEO_STATE_EXIT || this->isCapturing())
+    return -1;
+  uint32_t target;
+  if (!ev->newRecord(this, target))
+    return -1;
+  auto req = this->comq.newRequest();
+  if (req == nullptr) {
+    // the record is never reached on this context; do not block waiters.
+    ev->signal(target);
+    return -1;
+  }
+  req->setRecordEvent(ev, target);
+  this->comq.pushRequest(req);
+  return 0;
+}
+
+/**
+ * @brief make the following requests wait for an event
+ *
+ * @param ev event to wait for
+ * @return zero upon success; -1 upon failure.
+ *
+ * The requests submitted to this context after this call start after
+ * the last record of the event at the time of this call is reached.
+ * The wait is resolved by the pseudo thread without the host thread.
+ * Nothing is enqueued if the event has never been recorded or if
+ * the record has already been reached.
+ */
+int ThreadContext::waitEvent(Event *ev)
+{
+  if (this->state == VEO_STATE_EXIT || this->isCapturing())
+    return -1;
+  auto target = ev->lastRecord();
+  if (ev->isReached(target))
+    return 0;
+  auto req = this->comq.newRequest();
+  if (req == nullptr)
+    return -1;
+  req->setWaitEvent(ev, target);
+  this->comq.pushRequest(req);
+  return 0;
+}
+} // namespace veo
@@ -0,0 +1,59 @@
+/**
+ * @file Event.hpp
+ * @brief events to order requests across contexts
+ *
+ * @internal
+ * @author VEO
+ */
+#ifndef _VEO_EVENT_HPP_
+#define _VEO_EVENT_HPP_
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include "ve_offload.h"
+
+namespace veo {
+class ThreadContext;
+
+/**
+ * @brief event marking a point in the request queue of a context
+ *
+ * Each record of an event is numbered by the host thread recording it.
+ * The pseudo thread of the context signals the number when it reaches
+ * the record, so that a wait on the event, either by another pseudo
+ * thread or by a host thread, sleeps until the number of the last record
+ * at the time of the wait is signalled. Numbers wrap around and are
+ * compared by their difference.
+ * Records on one context are reached in order, so reaching a number
+ * means reaching all numbers before it. Records on different contexts
+ * are not, so the event is recorded on another context only after
+ * the last record is reached.
+ */
+class Event {
+private:
+  std::mutex mtx;/*! serializes issuing records */
+  ThreadContext *recorder;/*! context of the last record */
+  std::atomic<uint32_t> recorded;/*! number of the last record issued */
+  std::atomic<uint32_t> signalled;/*! futex: number of the last reached */
+  std::atomic<uint32_t> waiters;/*! the number of threads waiting */
+  static bool reached(uint32_t s, uint32_t target) {
+    return static_cast<int32_t>(s - target) >= 0;
+  }
+public:
+  Event(): recorder(nullptr), recorded(0), signalled(0), waiters(0) {}
+  Event(const Event &) = delete;
+  bool newRecord(ThreadContext *, uint32_t &);
+  /**
+   * @brief the number of the last record issued
+   */
+  uint32_t lastRecord() { return this->recorded.load(); }
+  bool isReached(uint32_t target) {
+    return reached(this->signalled.load(std::memory_order_acquire), target);
+  }
+  void signal(uint32_t);
+  void wait(uint32_t);
+
+  veo_event *toCHandle() { return reinterpret_cast<veo_event *>(this); }
+};
+} // namespace veo
+#endif
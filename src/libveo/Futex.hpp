@@ -0,0 +1,102 @@
+/**
+ * @file Futex.hpp
+ * @brief thin wrappers of futex(2) and helpers to park, spin and wake threads
+ *
+ * @internal
+ * @author VEO
+ */
+#ifndef _VEO_FUTEX_HPP_
+#define _VEO_FUTEX_HPP_
+#include <atomic>
+#include <cstdint>
+#include <climits>
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+namespace veo {
+namespace internal {
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "std::atomic<uint32_t> cannot be used as a futex word");
+
+/**
+ * @brief sleep while a futex word holds the expected value
+ * @param word futex word
+ * @param expected value expected in the word
+ * @param timeout relative timeout; nullptr to wait infinitely.
+ * @return zero upon wakeup; -1 upon failure, e.g. EAGAIN when the word
+ *         does not hold the expected value, EINTR or ETIMEDOUT.
+ */
+inline int futex_wait(std::atomic<uint32_t> *word, uint32_t expected,
+                      const struct timespec *timeout = nullptr)
+{
+  return syscall(SYS_futex, reinterpret_cast<uint32_t *>(word),
+                 FUTEX_WAIT_PRIVATE, expected, timeout, nullptr, 0);
+}
+
+/**
+ * @brief wake threads sleeping on a futex word
+ * @param word futex word
+ * @param n the maximum number of threads to wake
+ * @return the number of threads woken up
+ */
+inline int futex_wake(std::atomic<uint32_t> *word, int n = INT_MAX)
+{
+  return syscall(SYS_futex, reinterpret_cast<uint32_t *>(word),
+                 FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+}
+
+/**
+ * @brief hint to the processor in a busy-wait loop
+ */
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#else
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+/**
+ * @brief monotonic clock in nanoseconds
+ */
+inline uint64_t now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+constexpr uint64_t NO_DEADLINE = UINT64_MAX;//!< deadline of infinite wait
+
+/**
+ * @brief deadline of a wait on the monotonic clock
+ * @param timeout_ns timeout in nanoseconds; negative to wait infinitely.
+ * @return deadline in nanoseconds; NO_DEADLINE if timeout_ns is negative.
+ */
+inline uint64_t deadline_ns(int64_t timeout_ns)
+{
+  return timeout_ns < 0 ? NO_DEADLINE : now_ns() + timeout_ns;
+}
+
+/**
+ * @brief time left until a deadline
+ * @param deadline deadline in nanoseconds
+ * @param[out] rel relative timeout to be passed to futex_wait()
+ * @return false if the deadline has passed.
+ */
+inline bool time_until(uint64_t deadline, struct timespec &rel)
+{
+  auto now = now_ns();
+  if (now >= deadline)
+    return false;
+  auto left = deadline - now;
+  rel.tv_sec = left / 1000000000UL;
+  rel.tv_nsec = left % 1000000000UL;
+  return true;
+}
+} // namespace internal
+} // namespace veo
+#endif
@@ -0,0 +1,136 @@
+/**
+ * @file Graph.cpp
+ * @brief implementation of capture and replay of commands
+ */
+#include "Graph.hpp"
+#include "CallArgs.hpp"
+#include "CallPlan.hpp"
+#include "ThreadContext.hpp"
+#include "log.hpp"
+
+namespace veo {
+/**
+ * @brief start capturing requests submitted to this context
+ * @return zero upon success; -1 if already capturing.
+ */
+int ThreadContext::beginCapture()
+{
+  std::unique_ptr<Graph> g(new Graph());
+  Graph *expected = nullptr;
+  if (!this->capturing.compare_exchange_strong(expected, g.get()))
+    return -1;
+  g.release();
+  return 0;
+}
+
+/**
+ * @brief stop capturing requests
+ * @return the graph captured; nullptr if not capturing.
+ */
+Graph *ThreadContext::endCapture()
+{
+  return this->capturing.exchange(nullptr);
+}
+
+/**
+ * @brief replay a graph
+ *
+ * @param g graph to launch
+ * @return request ID
+ */
+uint64_t ThreadContext::launchGraph(Graph *g)
+{
+  if (this->state == VEO_STATE_EXIT ||
+      this->capturing.load(std::memory_order_acquire) != nullptr)
+    return VEO_REQUEST_ID_INVALID;
+  auto req = this->comq.newRequest();
+  if (req == nullptr)
+    return VEO_REQUEST_ID_INVALID;
+  req->setLaunchGraph(g);
+  return this->comq.pushRequest(req);
+}
+
+/**
+ * @brief start a call node of a graph on VE thread
+ *
+ * @param node node of a call
+ *
+ * The arguments are marshalled when the node is executed first, when
+ * the stack pointer or the layout of the arguments has changed, when
+ * the arguments have been set up for another call or when arguments
+ * are on VE heap; otherwise, only the values of the arguments are
+ * written into the stack image marshalled before.
+ */
+void ThreadContext::_doGraphCall(Graph::Node &node)
+{
+  auto &args = *node.cmd.param.call.args;
+  // addresses of buffers on VE heap can change at each launch.
+  if (node.sp != this->ve_sp || node.layout != args.layoutVersion()
+      || node.top != args.stackTop() || args.hasHeapArgs()) {
+    VEO_DEBUG(this, "marshal graph node for sp = %p", (void *)this->ve_sp);
+    node.sp = this->ve_sp;
+    node.layout = args.layoutVersion();
+    args.setup(this->ve_sp);
+    node.top = this->ve_sp;
+  } else {
+    args.update();
+    this->ve_sp = node.top;
+  }
+  node.nregs = args.getRegVal(node.regs);
+  this->_startCall(node.cmd.param.call.addr, args, node.regs, node.nregs);
+}
+
+/**
+ * @brief function to be set to launch graph request (command)
+ *
+ * The nodes are executed in order until one of them fails.
+ * The result of the request is the result of the last node executed.
+ */
+int ThreadContext::_launchGraphCommandHandler(Command *cmd)
+{
+  auto g = cmd->param.graph.graph;
+  VEO_TRACE(this, "[request #%lu] launch graph %p (%lu nodes)",
+            cmd->getID(), g, g->size());
+  cmd->setResult(0, VEO_COMMAND_OK);
+  for (size_t i = 0; i < g->size(); ++i) {
+    auto &node = g->node(i);
+    auto c = &node.cmd;
+    int rv;
+    switch (c->getType()) {
+    case VEO_COMMAND_TYPE_CALL:
+      rv = 0;
+      if (!this->_acquireHeap(c))
+        break;
+      this->_doGraphCall(node);
+      rv = this->_waitCall(c);
+      break;
+    case VEO_COMMAND_TYPE_LAUNCH_PLAN:
+      rv = 0;
+      if (!this->_acquireHeap(c))
+        break;
+      this->_doPlanCall(*c->param.call.plan);
+      rv = this->_waitCall(c);
+      break;
+    case VEO_COMMAND_TYPE_READ_MEM:
+      rv = this->_readMemCommandHandler(c);
+      break;
+    case VEO_COMMAND_TYPE_WRITE_MEM:
+      rv = this->_writeMemCommandHandler(c);
+      break;
+    case VEO_COMMAND_TYPE_CALL_VH:
+      rv = this->_callVHCommandHandler(c);
+      break;
+    default:
+      VEO_ERROR(this, "node %lu has unexpected type %d", i, c->getType());
+      c->setResult(0, VEO_COMMAND_ERROR);
+      rv = 0;
+    }
+    cmd->setResult(c->getRetval(), c->getStatus());
+    if (rv != 0 || c->getStatus() != VEO_COMMAND_OK) {
+      VEO_ERROR(this, "graph %p stopped at node %lu", g, i);
+      return rv;
+    }
+  }
+  return 0;
+}
+} // namespace veo
@@ -0,0 +1,67 @@
+/**
+ * @file Graph.hpp
+ * @brief graphs of commands captured on a context and replayed
+ *
+ * @internal
+ * @author VEO
+ */
+#ifndef _VEO_GRAPH_HPP_
+#define _VEO_GRAPH_HPP_
+#include <deque>
+#include <mutex>
+#include "CallArgs.hpp"
+#include "Command.hpp"
+
+namespace veo {
+/**
+ * @brief immutable sequence of commands replayed by one request
+ *
+ * While a context is capturing, requests submitted to it are added to
+ * the graph as nodes instead of being pushed to the request queue.
+ * A launch of the graph is one command, which executes the nodes
+ * in order on the pseudo thread without any traffic on the request
+ * queue and the completion table.
+ *
+ * The arguments of a call node are marshalled on its first launch and
+ * the register values and the stack image are kept for later launches
+ * on the same stack pointer; only IN buffers on stack are read again.
+ */
+class Graph {
+public:
+  /**
+   * @brief node of graph
+   */
+  struct Node {
+    Command cmd;//!< command to execute; the result is stored in it.
+    uint64_t sp;//!< stack pointer the arguments are marshalled for
+    uint64_t layout;//!< layout version of the arguments marshalled
+    uint64_t top;//!< stack pointer with the arguments on stack
+    uint64_t regs[NUM_ARGS_ON_REGISTER];//!< arguments on registers
+    int nregs;//!< the number of arguments on registers
+    Node(): sp(0), layout(0), top(0), nregs(0) {}
+  };
+private:
+  std::mutex mtx;/*! protects nodes while capturing */
+  std::deque<Node> nodes;/*! references are stable on addition */
+
+public:
+  Graph() {}
+  Graph(const Graph &) = delete;
+  /**
+   * @brief add a node
+   * @param fill function to fill the command of the node: fill(cmd)
+   * @return index of the node
+   */
+  template <typename F> uint64_t addNode(F fill) {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->nodes.emplace_back();
+    fill(&this->nodes.back().cmd);
+    return this->nodes.size() - 1;
+  }
+  size_t size() { return this->nodes.size(); }
+  Node &node(size_t i) { return this->nodes[i]; }
+
+  veo_graph *toCHandle() { return reinterpret_cast<veo_graph *>(this); }
+};
+} // namespace veo
+#endif
@@ -0,0 +1,79 @@
+/**
+ * @file HeapPool.cpp
+ * @brief implementation of the pool of VE heap buffers
+ */
+#include "HeapPool.hpp"
+#include "ProcHandle.hpp"
+#include "log.hpp"
+
+namespace veo {
+/**
+ * @brief size class of a buffer
+ * @param size size in bytes
+ * @return size class; the buffer of class k has MIN_SIZE << k bytes.
+ *         -1 if size is too large.
+ */
+int HeapPool::sizeClass(size_t size)
+{
+  int k = 0;
+  while ((MIN_SIZE << k) < size) {
+    if (++k >= NUM_CLASSES)
+      return -1;
+  }
+  return k;
+}
+
+/**
+ * @brief acquire a VE heap buffer
+ * @param size size in bytes
+ * @return VEMVA of the buffer; zero upon failure.
+ */
+uint64_t HeapPool::acquire(size_t size)
+{
+  auto k = sizeClass(size);
+  if (k < 0)
+    return 0;
+  {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    auto &l = this->free_list[k];
+    if (!l.empty()) {
+      auto addr = l.back();
+      l.pop_back();
+      return addr;
+    }
+  }
+  try {
+    auto addr = this->proc->allocBuff(MIN_SIZE << k);
+    VEO_DEBUG(nullptr, "allocate VE heap buffer %#lx (%lu bytes)",
+              addr, MIN_SIZE << k);
+    return addr;
+  } catch (VEOException &e) {
+    VEO_ERROR(nullptr, "failed to allocate VE heap buffer: %s", e.what());
+    return 0;
+  }
+}
+
+/**
+ * @brief release a VE heap buffer
+ * @param addr VEMVA of the buffer acquired
+ * @param size size in bytes passed to acquire()
+ */
+void HeapPool::release(uint64_t addr, size_t size)
+{
+  auto k = sizeClass(size);
+  {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    auto &l = this->free_list[k];
+    if (l.size() < MAX_CACHED) {
+      l.push_back(addr);
+      return;
+    }
+  }
+  try {
+    this->proc->freeBuff(addr);
+  } catch (VEOException &e) {
+    VEO_ERROR(nullptr, "failed to free VE heap buffer %#lx: %s",
+              addr, e.what());
+  }
+}
+} // namespace veo
@@ -0,0 +1,44 @@
+/**
+ * @file HeapPool.hpp
+ * @brief pool of VE heap buffers for arguments
+ *
+ * @internal
+ * @author VEO
+ */
+#ifndef _VEO_HEAP_POOL_HPP_
+#define _VEO_HEAP_POOL_HPP_
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace veo {
+class ProcHandle;
+
+/**
+ * @brief pool of VE heap buffers
+ *
+ * Buffers are allocated in sizes of powers of two from MIN_SIZE and
+ * kept on release for later acquisitions of the same size class, up to
+ * MAX_CACHED buffers per class. A process handle owns a pool shared by
+ * its contexts.
+ */
+class HeapPool {
+public:
+  static constexpr size_t MIN_SIZE = 1024 * 1024;//!< the smallest class
+  static constexpr int NUM_CLASSES = 32;
+  static constexpr size_t MAX_CACHED = 4;//!< buffers kept per class
+private:
+  ProcHandle *proc;
+  std::mutex mtx;
+  std::vector<uint64_t> free_list[NUM_CLASSES];
+
+  static int sizeClass(size_t);
+public:
+  explicit HeapPool(ProcHandle *p): proc(p) {}
+  HeapPool(const HeapPool &) = delete;
+  uint64_t acquire(size_t);
+  void release(uint64_t, size_t);
+};
+} // namespace veo
+#endif
@@ -7,7 +7,6 @@
 #include "VEOException.hpp"
 #include "CallArgs.hpp"
 #include "log.hpp"
-#include "CommandImpl.hpp"
 
 #include <string.h>
 #include <unistd.h>
@@ -436,7 +435,7 @@ int spawn_helper(ThreadContext *ctx, veos_handle *oshandle, const char *binname)
  * @param binname VE executable
  */
 ProcHandle::ProcHandle(const char *ossock, const char *vedev,
-                       const char *binname)
+                       const char *binname): heap_pool(this)
 {
   int retval;
   size_t funcs_sz;
@@ -688,36 +687,9 @@ void ProcHandle::exitProc()
   if ( this->funcs.exit == 0 || this->main_thread->state == VEO_STATE_EXIT)
     return;
 
-  auto id = this->worker.get()->issueRequestID();
-  auto f = [&args, this, id] (Command *cmd) {
-    this->worker.get()->_doCall(this->funcs.exit, args);
-    int status;
-    uint64_t exs;
-    auto successful = this->worker.get()->exceptionHandler(exs,
-			&ThreadContext::exitFilter);
-    if (!successful) {
-      if (status == VEO_HANDLER_STATUS_EXCEPTION) {
-        cmd->setResult(exs, VEO_COMMAND_EXCEPTION);
-      } else {
-        cmd->setResult(status, VEO_COMMAND_ERROR);
-      }
-      return 1;
-    }
-    cmd->setResult(0, VEO_COMMAND_OK);
-
-    // post
-    auto readmem = std::bind(&ThreadContext::_readMem, this->worker.get(),
-                             std::placeholders::_1, std::placeholders::_2,
-                             std::placeholders::_3);
-    args.copyout(readmem);
-    return 0;
-  };
-  std::unique_ptr<Command> req(new internal::CommandImpl(id, f));
-  if(this->worker.get()->comq.pushRequest(std::move(req)))
-    id = VEO_REQUEST_ID_INVALID;
-
+  auto id = this->worker->_callExit(this->funcs.exit, args);
   VEO_TRACE(nullptr, "[request #%d] pushRequest", id);
-  auto c = this->worker.get()->comq.waitCompletion(id);
+  this->worker->callWaitResult(id, &ret);
 
   /* exitProc() */
   VEO_TRACE(this->main_thread.get(), "%s()", __func__);
@@ -795,7 +767,10 @@ ThreadContext *ProcHandle::openContext(ThreadContextAttr &attr)
     VEO_ERROR(ctx, "openContext failed (%d)", rv);
     throw VEOException("request failed", ENOSYS);
   }
-  return reinterpret_cast<ThreadContext *>(ret);
+  auto newctx = reinterpret_cast<ThreadContext *>(ret);
+  if (static_cast<intptr_t>(ret) > 0)
+    newctx->setWaitPolicy(attr.getWaitPolicy());
+  return newctx;
 }
 
 /**
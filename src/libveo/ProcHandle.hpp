@@ -13,6 +13,8 @@
 #include <ve_offload.h>
 #include <veorun.h>
 #include "ThreadContext.hpp"
+#include "CompletionExecutor.hpp"
+#include "HeapPool.hpp"
 #include "VEOException.hpp"
 #include <limits.h>
 
@@ -38,6 +40,8 @@ private:
   std::unordered_map<std::pair<uint64_t, std::string>, uint64_t> sym_name;
   std::mutex sym_mtx;
   std::mutex main_mutex;//!< acquire while using main_thread
+  CompletionExecutor executor;//!< runs callbacks; outlives contexts
+  HeapPool heap_pool;//!< VE heap buffers for arguments
   std::unique_ptr<ThreadContext> main_thread;
   std::unique_ptr<ThreadContext> worker;
   struct veo__helper_functions_ver4 funcs;
@@ -81,6 +85,8 @@ public:
   }
 
   int veNumber() { return this->ve_number; }
+  CompletionExecutor *completionExecutor() { return &this->executor; }
+  HeapPool *heapPool() { return &this->heap_pool; }
   uint64_t getVeorunVersion() { return this->funcs.version; }
 };
 } // namespace veo
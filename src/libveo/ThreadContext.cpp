@@ -2,7 +2,9 @@
  * @file ThreadContext.cpp
  * @brief implementation of ThreadContext
  */
+#include <memory>
 #include <set>
+#include <vector>
 
 #include <pthread.h>
 #include <cerrno>
@@ -27,10 +29,11 @@ extern __thread sigset_t ve_proc_sigmask;
 } // extern "C"
 
 #include "CallArgs.hpp"
+#include "CallPlan.hpp"
 #include "veo_private_defs.h"
 #include "ThreadContext.hpp"
+#include "Futex.hpp"
 #include "ProcHandle.hpp"
-#include "CommandImpl.hpp"
 #include "VEOException.hpp"
 #include "log.hpp"
 
@@ -101,7 +104,11 @@ void start_child_thread(veos_handle *os_handle, void *arg)
 
 ThreadContext::ThreadContext(ProcHandle *p, veos_handle *osh, bool is_main):
   proc(p), os_handle(osh), state(VEO_STATE_UNKNOWN),
-  pseudo_thread(pthread_self()), is_main_thread(is_main), seq_no(0) {}
+  pseudo_thread(pthread_self()), is_main_thread(is_main), sp_hint(0),
+  capturing(nullptr), stack_owner(nullptr)
+{
+  this->comq.setExecutor(p->completionExecutor(), this->toCHandle());
+}
 
 /**
  * @brief handle a single exception from VE process
@@ -277,28 +284,54 @@ bool ThreadContext::exitFilter(int sysnum, int *break_flag)
 void ThreadContext::_doCall(uint64_t addr, CallArgs &args)
 {
   VEO_TRACE(this, "%s(%#lx, ...)", __func__, addr);
-  VEO_DEBUG(this, "VE function = %p", (void *)addr);
-  ve_set_user_reg(this->os_handle, SR12, addr, ~0UL);
   // ve_sp is updated in CallArgs::setup()
   VEO_DEBUG(this, "current stack pointer = %p", (void *)this->ve_sp);
   args.setup(this->ve_sp);
-  auto regs = args.getRegVal(this->ve_sp);
-  VEO_ASSERT(regs.size() <= NUM_ARGS_ON_REGISTER);
-  for (auto i = 0; i < regs.size(); ++i) {
+  uint64_t regs[NUM_ARGS_ON_REGISTER];
+  auto nregs = args.getRegVal(regs);
+  this->_startCall(addr, args, regs, nregs);
+}
+
+/**
+ * @brief start a function on VE thread with arguments marshalled
+ *
+ * @param addr VEMVA of function called
+ * @param args arguments of the function set up for ve_sp
+ * @param regs arguments on registers
+ * @param nregs the number of arguments on registers
+ * @param plan plan of the call; nullptr if not launched by a plan.
+ */
+void ThreadContext::_startCall(uint64_t addr, CallArgs &args,
+                               const uint64_t *regs, int nregs,
+                               CallPlan *plan)
+{
+  VEO_DEBUG(this, "VE function = %p", (void *)addr);
+  ve_set_user_reg(this->os_handle, SR12, addr, ~0UL);
+  VEO_ASSERT(nregs <= NUM_ARGS_ON_REGISTER);
+  for (auto i = 0; i < nregs; ++i) {
     // set register arguments
     uint64_t regval = regs[i];
     VEO_DEBUG(this, "arg#%d: %#lx", i, regval);
     ve_set_user_reg(this->os_handle, SR00 + i, regval, ~0UL);
   }
-  auto writemem = std::bind(&ThreadContext::_writeMem, this,
-                            std::placeholders::_1, std::placeholders::_2,
-                            std::placeholders::_3);
-  args.copyin(writemem);
+  // a lambda capturing only this is stored in std::function without
+  // allocation.
+  auto writemem = [this](uint64_t dst, const void *src, size_t size) {
+    return this->_writeMem(dst, src, size);
+  };
+  if (plan != nullptr) {
+    args.copyinChanged(writemem, plan->shadow.get(),
+                       this->stack_owner == plan);
+  } else {
+    args.copyin(writemem);
+  }
+  // the stack image on VE belongs to the last plan launched.
+  this->stack_owner = plan;
   // shift the stack pointer as the stack is extended.
   VEO_DEBUG(this, "set stack pointer -> %p", (void *)this->ve_sp);
   ve_set_user_reg(this->os_handle, SR11, this->ve_sp, ~0UL);
   VEO_TRACE(this, "unblock (start at %p)", (void *)addr);
-  this->_unBlock(regs.size() > 0 ? regs[0] : 0);
+  this->_unBlock(nregs > 0 ? regs[0] : 0);
 }
 
 /**
@@ -328,6 +361,7 @@ uint64_t ThreadContext::_collectReturnValue()
   VEO_ASSERT(args[0] == VE_SYSVE_VEO_BLOCK);
   // update the current sp
   this->ve_sp = args[5];
+  this->sp_hint.store(this->ve_sp, std::memory_order_relaxed);
   VEO_DEBUG(this, "return = %#lx, sp = %#012lx", args[1], this->ve_sp);
   return args[1];
 }
@@ -430,26 +464,62 @@ void ThreadContext::eventLoop()
   while (this->state == VEO_STATE_BLOCKED) {
     // Restore the signal mask before popping queue.
     pthread_sigmask(SIG_SETMASK, &ve_proc_sigmask, NULL);
-    auto command = std::move(this->comq.popRequest());
+    auto command = this->comq.popRequest();
     // Block all signals
     pthread_sigmask(SIG_BLOCK, &signal_mask, NULL);
-    auto rv = (*command)();
+    auto rv = this->handleCommand(command);
     if (rv != 0) {
       this->state = VEO_STATE_EXIT;
       this->comq.setRequestStatus(VEO_QUEUE_CLOSED);
-      this->comq.pushCompletion(std::move(command));
+      this->comq.pushCompletion(command);
       this->comq.setCompletion();
       VEO_ERROR(this, "Internal error on executing a command(%d)", rv);
       return;
     }
-    this->comq.pushCompletion(std::move(command));
+    this->comq.pushCompletion(command);
   }
 }
 
+/**
+ * @brief execute a command
+ * @param cmd command popped from request queue
+ * @return zero upon success; non-zero upon internal error.
+ */
+int ThreadContext::handleCommand(Command *cmd)
+{
+  switch (cmd->getType()) {
+  case VEO_COMMAND_TYPE_CALL:
+    return this->_callCommandHandler(cmd);
+  case VEO_COMMAND_TYPE_READ_MEM:
+    return this->_readMemCommandHandler(cmd);
+  case VEO_COMMAND_TYPE_WRITE_MEM:
+    return this->_writeMemCommandHandler(cmd);
+  case VEO_COMMAND_TYPE_CALL_VH:
+    return this->_callVHCommandHandler(cmd);
+  case VEO_COMMAND_TYPE_LAUNCH_GRAPH:
+    return this->_launchGraphCommandHandler(cmd);
+  case VEO_COMMAND_TYPE_LAUNCH_PLAN:
+    return this->_launchPlanCommandHandler(cmd);
+  case VEO_COMMAND_TYPE_OPEN_CONTEXT:
+    return this->_openContextCommandHandler(cmd);
+  case VEO_COMMAND_TYPE_EXIT:
+    return this->_exitCommandHandler(cmd);
+  case VEO_COMMAND_TYPE_CLOSE:
+    return this->_closeCommandHandler(cmd);
+  case VEO_COMMAND_TYPE_RECORD_EVENT:
+    return this->_recordEventCommandHandler(cmd);
+  case VEO_COMMAND_TYPE_WAIT_EVENT:
+    return this->_waitEventCommandHandler(cmd);
+  }
+  VEO_ERROR(this, "unknown command type %d", cmd->getType());
+  cmd->setResult(0, VEO_COMMAND_ERROR);
+  return 0;
+}
+
 /**
  * @brief function to be set to close request (command)
  */
-int64_t ThreadContext::_closeCommandHandler(uint64_t id)
+int ThreadContext::_closeCommandHandler(Command *cmd)
 {
   VEO_TRACE(this, "%s()", __func__);
   process_thread_cleanup(this->os_handle, -1);
@@ -458,11 +528,9 @@ int64_t ThreadContext::_closeCommandHandler(uint64_t id)
    * pthread_exit() can invoke destructors for objects on the stack,
    * which can cause double-free.
    */
-  auto dummy = [](Command *)->int64_t{return 0;};
-  auto newc = new internal::CommandImpl(id, dummy);
+  cmd->setResult(0, 0);
   /* push the reply here because this function never returns. */
-  newc->setResult(0, 0);
-  this->comq.pushCompletion(std::unique_ptr<Command>(newc));
+  this->comq.pushCompletion(cmd);
   pthread_exit(0);
   return 0;
 }
@@ -480,13 +548,119 @@ int ThreadContext::close()
   if ( this->state == VEO_STATE_EXIT )
     return 0;
 
-  auto id = this->issueRequestID();
-  auto f = std::bind(&ThreadContext::_closeCommandHandler, this, id);
-  std::unique_ptr<Command> req(new internal::CommandImpl(id, f));
-  if(this->comq.pushRequest(std::move(req)))
-    id = VEO_REQUEST_ID_INVALID;
-  auto c = this->comq.waitCompletion(id);
-  return c->getRetval();
+  auto req = this->comq.newRequest();
+  if (req == nullptr)
+    return 0;// the pseudo thread has already exited.
+  req->setClose();
+  auto id = this->comq.pushRequest(req);
+  uint64_t retval;
+  this->comq.waitCompletion(id, &retval);
+  return retval;
+}
+
+/**
+ * @brief function to be set to call request (command)
+ */
+int ThreadContext::_callCommandHandler(Command *cmd)
+{
+  VEO_TRACE(this, "[request #%d] start...", cmd->getID());
+  auto &call = cmd->param.call;
+  if (call.prepared && call.sp == this->ve_sp) {
+    // marshalled on submission; only transfer and start.
+    uint64_t regs[NUM_ARGS_ON_REGISTER];
+    int nregs = call.args->getRegVal(regs);
+    this->ve_sp = call.args->stackTop();
+    this->_startCall(call.addr, *call.args, regs, nregs);
+    return this->_waitCall(cmd);
+  }
+  call.prepared = false;
+  if (!this->_acquireHeap(cmd))
+    return 0;
+  this->_doCall(call.addr, *call.args);
+  return this->_waitCall(cmd);
+}
+
+/**
+ * @brief marshal arguments of a call on the submitting thread
+ *
+ * @param cmd command of the call
+ *
+ * The arguments are marshalled for the stack pointer at the last block
+ * of VE thread, where the next call starts unless a function has been
+ * running. The pseudo thread marshals them again if the stack pointer
+ * differs.
+ * Only a snapshot owned by the command is marshalled; the arguments
+ * object of other calls can be set up by the pseudo thread for a call
+ * in flight at the same time. Arguments on VE heap are marshalled by
+ * the pseudo thread after the buffers are acquired.
+ */
+void ThreadContext::_prepareCall(Command *cmd)
+{
+  auto sp = this->sp_hint.load(std::memory_order_relaxed);
+  if (sp == 0 || this->capturing.load(std::memory_order_acquire) != nullptr)
+    return;
+  auto &call = cmd->param.call;
+  auto &args = *call.args;
+  if (!call.owned || args.hasHeapArgs())
+    return;
+  uint64_t top = sp;
+  args.setup(top);
+  call.sp = sp;
+  call.prepared = true;
+}
+
+/**
+ * @brief acquire VE heap buffers for arguments of a call
+ *
+ * @param cmd command of the call
+ * @return true upon success; false if the buffers cannot be acquired,
+ *         with the result of the command set to VEO_COMMAND_ERROR.
+ */
+bool ThreadContext::_acquireHeap(Command *cmd)
+{
+  if (cmd->param.call.args->acquireHeap(*this->proc->heapPool()))
+    return true;
+  VEO_ERROR(this, "[request #%lu] failed to place arguments on VE heap",
+            cmd->getID());
+  cmd->setResult(0, VEO_COMMAND_ERROR);
+  return false;
+}
+
+/**
+ * @brief wait for a function started on VE thread to return
+ *
+ * @param cmd command of the call; the result is set.
+ * @return zero upon success; non-zero upon failure of VE thread.
+ */
+int ThreadContext::_waitCall(Command *cmd)
+{
+  auto id = cmd->getID();
+  auto &args = *cmd->param.call.args;
+  VEO_TRACE(this, "[request #%d] VE execution", id);
+  int status;
+  uint64_t exs;
+  auto successful = this->_executeVE(status, exs);
+  VEO_TRACE(this, "[request #%d] executed.", id);
+  if (!successful) {
+    VEO_ERROR(this, "_executeVE() failed (%d, exs=0x%016lx)", status, exs);
+    if (status == VEO_HANDLER_STATUS_EXCEPTION) {
+      cmd->setResult(exs, VEO_COMMAND_EXCEPTION);
+    } else {
+      cmd->setResult(status, VEO_COMMAND_ERROR);
+    }
+    return 1;
+  }
+  auto rv = this->_collectReturnValue();
+  cmd->setResult(rv, VEO_COMMAND_OK);
+  // post
+  VEO_TRACE(this, "[request #%d] post process", id);
+  args.copyout([this](void *dst, uint64_t src, size_t size) {
+    return this->_readMem(dst, src, size);
+  });
+  // buffers are not released upon failure as VE process is not usable.
+  args.releaseHeap(*this->proc->heapPool());
+  VEO_TRACE(this, "[request #%d] done", id);
+  return 0;
 }
 
 /**
@@ -494,46 +668,27 @@ int ThreadContext::close()
  *
  * @param addr VEMVA of VE function to call
  * @param args arguments of the function
+ * @param cb callback on completion; nullptr to pick up the result by
+ *        callWaitResult() or callPeekResult().
+ * @param user pointer passed to the callback
+ * @param prio priority of the request (enum veo_request_priority)
  * @return request ID
  */
-uint64_t ThreadContext::callAsync(uint64_t addr, CallArgs &args)
+uint64_t ThreadContext::callAsync(uint64_t addr, CallArgs &args,
+                                  veo_completion_cb cb, void *user, int prio)
 {
-  if ( addr == 0 || this->state == VEO_STATE_EXIT)
+  if ( addr == 0 || this->state == VEO_STATE_EXIT || !validPriority(prio))
     return VEO_REQUEST_ID_INVALID;
-  
-  auto id = this->issueRequestID();
-  auto f = [&args, this, addr, id] (Command *cmd) {
-    VEO_TRACE(this, "[request #%d] start...", id);
-    this->_doCall(addr, args);
-    VEO_TRACE(this, "[request #%d] VE execution", id);
-    int status;
-    uint64_t exs;
-    auto successful = this->_executeVE(status, exs);
-    VEO_TRACE(this, "[request #%d] executed.", id);
-    if (!successful) {
-      VEO_ERROR(this, "_executeVE() failed (%d, exs=0x%016lx)", status, exs);
-      if (status == VEO_HANDLER_STATUS_EXCEPTION) {
-        cmd->setResult(exs, VEO_COMMAND_EXCEPTION);
-      } else {
-        cmd->setResult(status, VEO_COMMAND_ERROR);
-      }
-      return 1;
-    }
-    auto rv = this->_collectReturnValue();
-    cmd->setResult(rv, VEO_COMMAND_OK);
-    // post
-    VEO_TRACE(this, "[request #%d] post process", id);
-    auto readmem = std::bind(&ThreadContext::_readMem, this,
-                             std::placeholders::_1, std::placeholders::_2,
-                             std::placeholders::_3);
-    args.copyout(readmem);
-    VEO_TRACE(this, "[request #%d] done", id);
-    return 0;
-  };
 
-  std::unique_ptr<Command> req(new internal::CommandImpl(id, f));
-  if(this->comq.pushRequest(std::move(req)))
-    return VEO_REQUEST_ID_INVALID;
+  std::unique_ptr<CallArgs> snap(this->_snapshot(args));
+  auto argp = snap ? snap.get() : &args;
+  bool owned = static_cast<bool>(snap);
+  auto id = this->_submit(cb, user, prio, [=](Command *req) {
+    req->setCall(addr, argp, owned);
+    this->_prepareCall(req);
+  });
+  if (id != VEO_REQUEST_ID_INVALID)
+    snap.release();// owned by the command
   return id;
 }
 
@@ -551,6 +706,80 @@ uint64_t ThreadContext::callAsyncByName(uint64_t libhdl, const char *symname, Ca
   return this->callAsync(addr, args);
 }
 
+/**
+ * @brief call VE functions asynchronously in a batch
+ *
+ * @param n the number of calls
+ * @param addrs array of VEMVAs of VE functions to call
+ * @param args array of arguments of the functions
+ * @param[out] ids array to store request IDs
+ * @return the number of requests submitted; -1 upon invalid arguments.
+ *
+ * The calls are enqueued under consecutive request IDs and published
+ * to the pseudo thread at once.
+ */
+int ThreadContext::callAsyncBatch(int n, const uint64_t *addrs,
+                                  CallArgs *const *args, uint64_t *ids)
+{
+  if (n < 0 || this->state == VEO_STATE_EXIT)
+    return -1;
+  for (int i = 0; i < n; ++i) {
+    if (addrs[i] == 0 || args[i] == nullptr)
+      return -1;
+  }
+  // snapshots are allocated only if any arguments are in snapshot mode.
+  std::vector<std::unique_ptr<CallArgs>> snaps;
+  for (int i = 0; i < n; ++i) {
+    if (!args[i]->isSnapshot())
+      continue;
+    if (snaps.empty())
+      snaps.resize(n);
+    snaps[i].reset(this->_snapshot(*args[i]));
+  }
+  auto rv = this->_submitBatch(n, ids, [this, addrs, args, &snaps](int i,
+                                                      Command *cmd) {
+    if (!snaps.empty() && snaps[i])
+      cmd->setCall(addrs[i], snaps[i].get(), true);
+    else
+      cmd->setCall(addrs[i], args[i]);
+    this->_prepareCall(cmd);
+  });
+  for (size_t i = 0; i < snaps.size(); ++i) {
+    if (ids[i] != VEO_REQUEST_ID_INVALID)
+      snaps[i].release();// owned by the command
+  }
+  return rv;
+}
+
+/**
+ * @brief take a snapshot of arguments for a call if requested
+ * @param args arguments of a call
+ * @return a snapshot owned by the caller; nullptr if args are not in
+ *         snapshot mode or while capturing, as a graph reads arguments
+ *         on each launch.
+ */
+CallArgs *ThreadContext::_snapshot(const CallArgs &args)
+{
+  if (!args.isSnapshot()
+      || this->capturing.load(std::memory_order_acquire) != nullptr)
+    return nullptr;
+  return args.snapshot();
+}
+
+/**
+ * @brief function to be set to VH call request (command)
+ */
+int ThreadContext::_callVHCommandHandler(Command *cmd)
+{
+  auto id = cmd->getID();
+  VEO_TRACE(this, "[request #%lu] start...", id);
+  auto rv = (*cmd->param.vh.func)(cmd->param.vh.arg);
+  VEO_TRACE(this, "[request #%lu] executed. (return %ld)", id, rv);
+  cmd->setResult(rv, VEO_COMMAND_OK);
+  VEO_TRACE(this, "[request #%lu] done", id);
+  return 0;
+}
+
 /**
  * @brief call a VH function asynchronously
  *
@@ -563,18 +792,51 @@ uint64_t ThreadContext::callVHAsync(uint64_t (*func)(void *), void *arg)
   if ( func == nullptr || this->state == VEO_STATE_EXIT)
     return VEO_REQUEST_ID_INVALID;
 
-  auto id = this->issueRequestID();
-  auto f = [this, func, arg, id] (Command *cmd) {
-    VEO_TRACE(this, "[request #%lu] start...", id);
-    auto rv = (*func)(arg);
-    VEO_TRACE(this, "[request #%lu] executed. (return %ld)", id, rv);
+  return this->_submit(nullptr, nullptr, VEO_PRIO_NORMAL,
+                       [=](Command *req) { req->setCallVH(func, arg); });
+}
+
+/**
+ * @brief function to be set to open context request (command)
+ */
+int ThreadContext::_openContextCommandHandler(Command *cmd)
+{
+  auto id = cmd->getID();
+  VEO_TRACE(this, "[request #%d] start...", id);
+  this->_doCall(cmd->param.call.addr, *cmd->param.call.args);
+  VEO_TRACE(this, "[request #%d] VE execution", id);
+
+  uint64_t exc;
+  // hook clone() on VE
+  auto req = this->exceptionHandler(exc,
+               &ThreadContext::hookCloneFilter);
+  if (!_is_clone_request(req)) {
+    VEO_ERROR(this, "VE open context blocked unexpectedly. %p", exc);
+    cmd->setResult(exc, VEO_COMMAND_EXCEPTION);
+  }
+  // create a new ThreadContext for a child thread
+  std::unique_ptr<ThreadContext> newctx(new ThreadContext(
+                                   cmd->param.call.proc, this->os_handle));
+  // handle clone() request.
+  auto tid = newctx->handleCloneRequest();
+  VEO_DEBUG(this, "new context has TID %ld", tid);
+  // restart execution; execute until the next block request.
+  this->_unBlock(tid);
+  if (this->defaultExceptionHandler(exc)
+      != VEO_HANDLER_STATUS_BLOCK_REQUESTED) {
+    throw VEOException("Unexpected exception occured");
+  }
+  if(tid < 0){
+    VEO_ERROR(this, "newctx->handleCloneRequest() fail. (errno = %d)", -tid);
+    cmd->setResult(tid, VEO_COMMAND_OK);
+  }
+  else{
+    VEO_TRACE(newctx.get(), "sp = %p", (void *)newctx->ve_sp);
+    auto rv = newctx.release();
     cmd->setResult(rv, VEO_COMMAND_OK);
-    VEO_TRACE(this, "[request #%lu] done", id);
-    return 0;
-  };
-  std::unique_ptr<Command> req(new internal::CommandImpl(id, f));
-  this->comq.pushRequest(std::move(req));
-  return id;
+  }
+  VEO_TRACE(this, "[request #%d] done", id);
+  return 0;
 }
 
 uint64_t ThreadContext::_callOpenContext(ProcHandle *proc,
@@ -583,49 +845,54 @@ uint64_t ThreadContext::_callOpenContext(ProcHandle *proc,
   if ( this->state == VEO_STATE_EXIT )
     return VEO_REQUEST_ID_INVALID;
 
-  auto id = this->issueRequestID();
-  auto f = [&args, this, proc, addr, id] (Command *cmd) {
-    VEO_TRACE(this, "[request #%d] start...", id);
-    this->_doCall(addr, args);
-    VEO_TRACE(this, "[request #%d] VE execution", id);
-
-    uint64_t exc;
-    // hook clone() on VE
-    auto req = this->exceptionHandler(exc,
-                 &ThreadContext::hookCloneFilter);
-    if (!_is_clone_request(req)) {
-      VEO_ERROR(this, "VE open context blocked unexpectedly. %p", exc);
-      cmd->setResult(exc, VEO_COMMAND_EXCEPTION);
-    }
-    // create a new ThreadContext for a child thread
-    std::unique_ptr<ThreadContext> newctx(new ThreadContext(proc,
-                                     this->os_handle));
-    // handle clone() request.
-    auto tid = newctx->handleCloneRequest();
-    VEO_DEBUG(this, "new context has TID %ld", tid);
-    // restart execution; execute until the next block request.
-    this->_unBlock(tid);
-    if (this->defaultExceptionHandler(exc)
-        != VEO_HANDLER_STATUS_BLOCK_REQUESTED) {
-      throw VEOException("Unexpected exception occured");
-    }
-    if(tid < 0){
-      VEO_ERROR(this, "newctx->handleCloneRequest() fail. (errno = %d)", -tid);
-      cmd->setResult(tid, VEO_COMMAND_OK);
-    }
-    else{
-      VEO_TRACE(newctx.get(), "sp = %p", (void *)newctx->ve_sp);
-      auto rv = newctx.release();
-      cmd->setResult(rv, VEO_COMMAND_OK);
+  auto req = this->comq.newRequest();
+  if (req == nullptr)
+    return VEO_REQUEST_ID_INVALID;
+  req->setOpenContext(proc, addr, &args);
+  return this->comq.pushRequest(req);
+}
+
+/**
+ * @brief function to be set to exit request (command)
+ */
+int ThreadContext::_exitCommandHandler(Command *cmd)
+{
+  auto &args = *cmd->param.call.args;
+  this->_doCall(cmd->param.call.addr, args);
+  uint64_t exs;
+  // positive upon exit_group() or a block request
+  int status = this->exceptionHandler(exs, &ThreadContext::exitFilter);
+  if (status <= 0) {
+    if (status == VEO_HANDLER_STATUS_EXCEPTION) {
+      cmd->setResult(exs, VEO_COMMAND_EXCEPTION);
+    } else {
+      cmd->setResult(status, VEO_COMMAND_ERROR);
     }
-    VEO_TRACE(this, "[request #%d] done", id);
-    return 0;
-  };
+    return 1;
+  }
+  cmd->setResult(0, VEO_COMMAND_OK);
 
-  std::unique_ptr<Command> req(new internal::CommandImpl(id, f));
-  if(this->comq.pushRequest(std::move(req)))
+  // post
+  args.copyout([this](void *dst, uint64_t src, size_t size) {
+    return this->_readMem(dst, src, size);
+  });
+  return 0;
+}
+
+/**
+ * @brief request to terminate the VE process
+ *
+ * @param addr VEMVA of exit function in veorun
+ * @param args arguments of the function
+ * @return request ID
+ */
+uint64_t ThreadContext::_callExit(uint64_t addr, CallArgs &args)
+{
+  auto req = this->comq.newRequest();
+  if (req == nullptr)
     return VEO_REQUEST_ID_INVALID;
-  return id;
+  req->setExit(addr, &args);
+  return this->comq.pushRequest(req);
 }
 
 /**
@@ -637,22 +904,11 @@ uint64_t ThreadContext::_callOpenContext(ProcHandle *proc,
  * @retval VEO_COMMAND_EXCEPTION exception occured on the execution.
  * @retval VEO_COMMAND_ERROR error occured on handling the command.
  * @retval VEO_COMMAND_UNFINISHED the command is not finished.
+ * @retval VEO_COMMAND_CANCELLED the command was cancelled.
  */
 int ThreadContext::callPeekResult(uint64_t reqid, uint64_t *retp)
 {
-  std::lock_guard<std::mutex> lock(this->req_mtx);
-  auto itr = rem_reqid.find(reqid);
-  if( itr == rem_reqid.end() ) {
-    return VEO_COMMAND_ERROR;
-  }
-  auto c = this->comq.peekCompletion(reqid);
-  if (c != nullptr) {
-    if (!rem_reqid.erase(reqid))
-      return VEO_COMMAND_ERROR;
-    *retp = c->getRetval();
-    return c->getStatus();
-  }
-  return VEO_COMMAND_UNFINISHED;
+  return this->comq.peekCompletion(reqid, retp);
 }
 
 /**
@@ -660,27 +916,139 @@ int ThreadContext::callPeekResult(uint64_t reqid, uint64_t *retp)
  *
  * @param reqid request ID to wait
  * @param retp pointer to buffer to store the return value.
+ * @param timeout_ns timeout in nanoseconds; negative to wait infinitely.
  * @retval VEO_COMMAND_OK the execution of the function succeeded.
  * @retval VEO_COMMAND_EXCEPTION exception occured on the execution.
  * @retval VEO_COMMAND_ERROR error occured on handling the command.
- * @retval VEO_COMMAND_UNFINISHED the command is not finished.
+ * @retval VEO_COMMAND_UNFINISHED the command is not finished before
+ *         timeout; the result can be picked up later.
+ * @retval VEO_COMMAND_CANCELLED the command was cancelled.
  */
-int ThreadContext::callWaitResult(uint64_t reqid, uint64_t *retp)
+int ThreadContext::callWaitResult(uint64_t reqid, uint64_t *retp,
+                                  int64_t timeout_ns)
 {
-  req_mtx.lock();
-  auto itr = rem_reqid.find(reqid);
-  if( itr == rem_reqid.end() ) {
-    req_mtx.unlock();
-    return VEO_COMMAND_ERROR;
+  return this->comq.waitCompletion(reqid, retp, timeout_ns);
+}
+
+/**
+ * @brief cancel a request not started yet
+ *
+ * @param reqid request ID to cancel
+ * @retval 0 the request is cancelled.
+ * @retval -1 the request has already started or finished, or is invalid.
+ */
+int ThreadContext::callCancel(uint64_t reqid)
+{
+  return this->comq.cancelRequest(reqid) ? 0 : -1;
+}
+
+/**
+ * @brief cancel all requests not started yet on this context
+ *
+ * @return the number of requests cancelled
+ */
+int ThreadContext::callCancelAll()
+{
+  return this->comq.cancelAll();
+}
+
+namespace internal {
+/**
+ * @brief sleep on the completion notifier until a completion or deadline
+ * @param e epoch returned by CompletionNotifier::prepare()
+ * @param deadline deadline set by deadline_ns()
+ * @return false if the deadline has passed.
+ */
+bool sleep_for_completion(uint32_t e, uint64_t deadline)
+{
+  auto &notifier = CompletionTable::anyNotifier();
+  if (deadline == NO_DEADLINE) {
+    notifier.wait(e, nullptr);
+    return true;
   }
-  if (!rem_reqid.erase(reqid)) {
-    req_mtx.unlock();
-    return VEO_COMMAND_ERROR;
+  struct timespec rel;
+  if (!time_until(deadline, rel))
+    return false;
+  notifier.wait(e, &rel);
+  return true;
+}
+} // namespace internal
+
+/**
+ * @brief wait for the first result of requests on contexts
+ *
+ * @param reqs array of pairs of context and request ID
+ * @param n the number of requests
+ * @param timeout_ns timeout in nanoseconds; negative to wait infinitely.
+ * @param[out] index index of the request whose result is picked up
+ * @param[out] retp pointer to buffer to store the return value.
+ * @return the status of the request picked up; VEO_COMMAND_UNFINISHED
+ *         upon timeout.
+ *
+ * The result of only one request is picked up even if more requests
+ * have finished. A request whose result has already been picked up
+ * is regarded as finished with VEO_COMMAND_ERROR.
+ */
+int ThreadContext::waitAny(const veo_request *reqs, int n,
+                           int64_t timeout_ns, int *index, uint64_t *retp)
+{
+  auto &notifier = CompletionTable::anyNotifier();
+  auto deadline = internal::deadline_ns(timeout_ns);
+  for (;;) {
+    auto e = notifier.prepare();
+    for (int i = 0; i < n; ++i) {
+      auto ctx = reinterpret_cast<ThreadContext *>(reqs[i].ctx);
+      int rv = ctx->callPeekResult(reqs[i].reqid, retp);
+      if (rv != VEO_COMMAND_UNFINISHED) {
+        notifier.finish();
+        *index = i;
+        return rv;
+      }
+    }
+    if (timeout_ns == 0 || !internal::sleep_for_completion(e, deadline)) {
+      notifier.finish();
+      return VEO_COMMAND_UNFINISHED;
+    }
+    notifier.finish();
+  }
+}
+
+/**
+ * @brief wait for results of some of requests on contexts
+ *
+ * @param reqs array of pairs of context and request ID
+ * @param n the number of requests
+ * @param timeout_ns timeout in nanoseconds; negative to wait infinitely.
+ * @param[out] status array to store the status of each request;
+ *             VEO_COMMAND_UNFINISHED if not finished.
+ * @param[out] retvals array to store the return value of each request
+ * @return the number of requests whose results are picked up;
+ *         zero upon timeout.
+ *
+ * This function blocks until at least one request finishes and picks up
+ * the results of all finished requests in reqs.
+ */
+int ThreadContext::waitSome(const veo_request *reqs, int n,
+                            int64_t timeout_ns, int *status, uint64_t *retvals)
+{
+  auto &notifier = CompletionTable::anyNotifier();
+  auto deadline = internal::deadline_ns(timeout_ns);
+  for (;;) {
+    auto e = notifier.prepare();
+    int finished = 0;
+    for (int i = 0; i < n; ++i) {
+      auto ctx = reinterpret_cast<ThreadContext *>(reqs[i].ctx);
+      status[i] = ctx->callPeekResult(reqs[i].reqid, &retvals[i]);
+      if (status[i] != VEO_COMMAND_UNFINISHED)
+        ++finished;
+    }
+    if (finished > 0 || timeout_ns == 0 ||
+        !internal::sleep_for_completion(e, deadline)) {
+      notifier.finish();
+      return finished;
+    }
+    notifier.finish();
   }
-  req_mtx.unlock();
-  auto c = this->comq.waitCompletion(reqid);
-  *retp = c->getRetval();
-  return c->getStatus();
 }
 
 /**
@@ -730,6 +1098,20 @@ bool _is_exit_request(int rv_handler)
 ThreadContextAttr::ThreadContextAttr()
 {
   this->stacksize = VEO_DEFAULT_STACK_SIZE;
+  this->waitpolicy = VEO_WAIT_PARK;
+}
+
+void ThreadContextAttr::setWaitPolicy(int policy)
+{
+  switch (policy) {
+  case VEO_WAIT_PARK:
+  case VEO_WAIT_SPIN:
+  case VEO_WAIT_ADAPTIVE:
+    this->waitpolicy = policy;
+    return;
+  }
+  VEO_ERROR(nullptr, "invalid wait policy of VEO context (%d)", policy);
+  throw VEOException("invalid wait policy of VEO context", EINVAL);
 }
 
 void ThreadContextAttr::setStacksize(size_t stack_sz)
@@ -6,8 +6,10 @@
 #define _VEO_THREAD_CONTEXT_HPP_
 
 #include "Command.hpp"
-#include <mutex>
-#include <unordered_set>
+#include "Graph.hpp"
+#include <algorithm>
+#include <atomic>
+#include <vector>
 #include <pthread.h>
 #include <semaphore.h>
 
@@ -30,6 +32,8 @@ enum ExceptionHandlerStatus {
 class ProcHandle;
 class RequestHandle;
 class CallArgs;
+class CallPlan;
+class Event;
 
 /**
  * @brief VEO thread context
@@ -44,10 +48,10 @@ private:
   CommQueue comq;
   veo_context_state state;
   bool is_main_thread;
-  uint64_t seq_no;
   uint64_t ve_sp;
-  std::unordered_set<uint64_t> rem_reqid;
-  std::mutex req_mtx;
+  std::atomic<uint64_t> sp_hint;/*! ve_sp at the last block */
+  std::atomic<Graph *> capturing;/*! graph capturing requests, if any */
+  CallPlan *stack_owner;/*! plan whose stack image is on VE stack */
 
   bool defaultFilter(int, int *);
   bool hookCloneFilter(int, int *);
@@ -75,38 +79,137 @@ private:
   void _unBlock(uint64_t);
   int handleCommand(Command *);
   void eventLoop();
-  /**
-   * @brief Issue a new request ID
-   * @return a request ID, 64 bit integer, to identify a command
-   */
-  uint64_t issueRequestID() {
-    uint64_t ret = VEO_REQUEST_ID_INVALID;
-    while (ret == VEO_REQUEST_ID_INVALID) {
-      ret = __atomic_fetch_add(&this->seq_no, 1, __ATOMIC_SEQ_CST);
-    }
-    std::lock_guard<std::mutex> lock(this->req_mtx);
-    rem_reqid.insert(ret);
-    return ret;
-  }
 
   // handlers for commands
-  int64_t _closeCommandHandler(uint64_t);
+  int _callCommandHandler(Command *);
+  int _readMemCommandHandler(Command *);
+  int _writeMemCommandHandler(Command *);
+  int _callVHCommandHandler(Command *);
+  int _openContextCommandHandler(Command *);
+  int _exitCommandHandler(Command *);
+  int _closeCommandHandler(Command *);
+  int _recordEventCommandHandler(Command *);
+  int _waitEventCommandHandler(Command *);
+  int _launchGraphCommandHandler(Command *);
+  int _launchPlanCommandHandler(Command *);
+  CallArgs *_snapshot(const CallArgs &);
+  void _prepareCall(Command *);
+  void _startCall(uint64_t, CallArgs &, const uint64_t *, int,
+                  CallPlan *plan = nullptr);
+  int _waitCall(Command *);
+  bool _acquireHeap(Command *);
+  void _doGraphCall(Graph::Node &);
+  void _doPlanCall(CallPlan &);
   bool _executeVE(int &, uint64_t &);
   int _readMem(void *, uint64_t, size_t);
   int _writeMem(uint64_t, const void *, size_t);
   uint64_t _callOpenContext(ProcHandle *, uint64_t, CallArgs &);
+  uint64_t _callExit(uint64_t, CallArgs &);
+  static bool validPriority(int prio) {
+    return prio >= VEO_PRIO_NORMAL && prio < CommQueue::NUM_LANES;
+  }
+
+  bool isCapturing() {
+    return this->capturing.load(std::memory_order_acquire) != nullptr;
+  }
+
+  /**
+   * @brief submit a request, or add it to the graph being captured
+   * @param cb callback on completion; nullptr if not used.
+   * @param user pointer passed to the callback
+   * @param prio priority of the request (enum veo_request_priority)
+   * @param fill function to fill the command: fill(cmd)
+   * @return request ID; the index of the node while capturing.
+   *
+   * Requests with callbacks cannot be captured.
+   */
+  template <typename F> uint64_t _submit(veo_completion_cb cb, void *user,
+                                         int prio, F fill) {
+    auto g = this->capturing.load(std::memory_order_acquire);
+    if (g != nullptr) {
+      if (cb != nullptr)
+        return VEO_REQUEST_ID_INVALID;
+      return g->addNode(fill);
+    }
+    auto req = this->comq.newRequest(prio);
+    if (req == nullptr)
+      return VEO_REQUEST_ID_INVALID;
+    fill(req);
+    req->setCallback(cb, user);
+    return this->comq.pushRequest(req);
+  }
+
+  /**
+   * @brief submit requests in batches of consecutive request IDs
+   * @param n the number of requests
+   * @param[out] ids array to store request IDs
+   * @param fill function to fill the i-th command: fill(i, cmd)
+   * @return the number of requests submitted
+   *
+   * Each batch is published to the pseudo thread at once. When the queue
+   * is closed in the middle, IDs of requests not submitted are set to
+   * VEO_REQUEST_ID_INVALID. While capturing, the requests are added to
+   * the graph and the indices of the nodes are set to ids.
+   */
+  template <typename F> int _submitBatch(int n, uint64_t *ids, F fill) {
+    auto g = this->capturing.load(std::memory_order_acquire);
+    if (g != nullptr) {
+      for (int i = 0; i < n; ++i)
+        ids[i] = g->addNode([&](Command *cmd) { fill(i, cmd); });
+      return n;
+    }
+    int submitted = 0;
+    while (submitted < n) {
+      size_t m = std::min(static_cast<size_t>(n - submitted),
+                          RequestQueue::CAPACITY);
+      auto first = this->comq.newRequests(m);
+      if (first == VEO_REQUEST_ID_INVALID)
+        break;
+      for (size_t i = 0; i < m; ++i) {
+        fill(submitted + i, this->comq.getRequest(first + i));
+        ids[submitted + i] = first + i;
+      }
+      this->comq.pushRequests(first, m);
+      submitted += m;
+    }
+    for (int i = submitted; i < n; ++i)
+      ids[i] = VEO_REQUEST_ID_INVALID;
+    return submitted;
+  }
 public:
   ThreadContext(ProcHandle *, veos_handle *, bool is_main = false);
-  ~ThreadContext() {};
+  ~ThreadContext() { delete this->capturing.load(); }
   ThreadContext(const ThreadContext &) = delete;//non-copyable
   veo_context_state getState() { return this->state; }
-  uint64_t callAsync(uint64_t, CallArgs &);
+  uint64_t callAsync(uint64_t, CallArgs &, veo_completion_cb cb = nullptr,
+                     void *user = nullptr, int prio = VEO_PRIO_NORMAL);
   uint64_t callAsyncByName(uint64_t, const char *, CallArgs &);
+  int callAsyncBatch(int, const uint64_t *, CallArgs *const *, uint64_t *);
   uint64_t callVHAsync(uint64_t (*)(void *), void *);
-  int callWaitResult(uint64_t, uint64_t *);
+  int callWaitResult(uint64_t, uint64_t *, int64_t timeout_ns = -1);
   int callPeekResult(uint64_t, uint64_t *);
-  uint64_t asyncReadMem(void *, uint64_t, size_t);
-  uint64_t asyncWriteMem(uint64_t, const void *, size_t);
+  int callCancel(uint64_t);
+  int callCancelAll();
+  int getCompletionFd() { return this->comq.getCompletionFd(); }
+  void setWaitPolicy(int p) { this->comq.setWaitPolicy(p); }
+  static int waitAny(const veo_request *, int, int64_t, int *, uint64_t *);
+  static int waitSome(const veo_request *, int, int64_t, int *, uint64_t *);
+  uint64_t asyncReadMem(void *, uint64_t, size_t,
+                        veo_completion_cb cb = nullptr, void *user = nullptr,
+                        int prio = VEO_PRIO_NORMAL);
+  uint64_t asyncWriteMem(uint64_t, const void *, size_t,
+                         veo_completion_cb cb = nullptr, void *user = nullptr,
+                         int prio = VEO_PRIO_NORMAL);
+  int asyncReadMemBatch(int, void *const *, const uint64_t *,
+                        const size_t *, uint64_t *);
+  int asyncWriteMemBatch(int, const uint64_t *, const void *const *,
+                         const size_t *, uint64_t *);
+  int recordEvent(Event *);
+  int waitEvent(Event *);
+  int beginCapture();
+  Graph *endCapture();
+  uint64_t launchGraph(Graph *);
+  uint64_t launchPlan(CallPlan *);
 
   /**
    * @brief default exception handler
@@ -140,6 +243,7 @@ bool _is_exit_request(int);
 class ThreadContextAttr {
 private:
   size_t stacksize;
+  int waitpolicy;
 
 public:
   ThreadContextAttr();
@@ -147,6 +251,8 @@ public:
 
   void setStacksize(size_t);
   size_t getStacksize() { return this->stacksize;}
+  void setWaitPolicy(int);
+  int getWaitPolicy() { return this->waitpolicy; }
 
   veo_thr_ctxt_attr *toCHandle() {
     return reinterpret_cast<veo_thr_ctxt_attr *>(this);
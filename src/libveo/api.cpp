@@ -48,6 +48,9 @@
 #include <cstring>
 #include "CallArgs.hpp"
 #include "ProcHandle.hpp"
+#include "Event.hpp"
+#include "Graph.hpp"
+#include "CallPlan.hpp"
 #include "VEOException.hpp"
 #include "log.hpp"
 
@@ -70,6 +73,23 @@ ThreadContextAttr *ThreadContextAttrFromC(veo_thr_ctxt_attr *ta)
 {
   return reinterpret_cast<ThreadContextAttr *>(ta);
 }
+Event *EventFromC(veo_event *ev)
+{
+  return reinterpret_cast<Event *>(ev);
+}
+Graph *GraphFromC(veo_graph *g)
+{
+  return reinterpret_cast<Graph *>(g);
+}
+CallPlan *CallPlanFromC(veo_call_plan *p)
+{
+  return reinterpret_cast<CallPlan *>(p);
+}
+// timeout in milliseconds to nanoseconds; negative to wait infinitely.
+int64_t TimeoutToNs(int timeout)
+{
+  return timeout < 0 ? -1 : timeout * 1000000L;
+}
 
 template <typename T> int veo_args_set_(veo_args *ca, int argnum, T val)
 {
@@ -91,6 +111,10 @@ using veo::api::CallArgsFromC;
 using veo::api::veo_args_set_;
 using veo::VEOException;
 using veo::api::ThreadContextAttrFromC;
+using veo::api::TimeoutToNs;
+using veo::api::EventFromC;
+using veo::api::GraphFromC;
+using veo::api::CallPlanFromC;
 
 // implementation of VEO API functions
 /**
@@ -395,6 +419,24 @@ int veo_context_close(veo_thr_ctxt *ctx)
   return rv;
 }
 
+/**
+ * @brief get a file descriptor notifying completions on a VEO context
+ *
+ * @param ctx a VEO context
+ * @return file descriptor of eventfd; -1 upon failure.
+ *
+ * The file descriptor becomes readable when a request on the context
+ * finishes, so that it can be watched by poll(2), epoll(7) and so on.
+ * Read the 8-byte counter from it to clear the notification, then pick
+ * up the results by veo_call_peek_result().
+ * The descriptor is owned by the context; do not close it.
+ * It is closed by veo_context_close().
+ */
+int veo_context_get_completion_fd(veo_thr_ctxt *ctx)
+{
+  return ThreadContextFromC(ctx)->getCompletionFd();
+}
+
 /**
  * @brief get VEO context state
  * 
@@ -448,6 +490,88 @@ uint64_t veo_call_async_by_name(veo_thr_ctxt *ctx, uint64_t libhdl,
   }
 }
 
+/**
+ * @brief request a VE thread to call a function with a callback
+ *
+ * @param ctx VEO context to execute the function on VE.
+ * @param addr VEMVA of the function to call
+ * @param args arguments to be passed to the function
+ * @param cb callback invoked on completion
+ * @param user pointer passed to the callback
+ * @return request ID
+ * @retval VEO_REQUEST_ID_INVALID request failed.
+ *
+ * The callback is invoked on a thread of VEO with the status and the
+ * return value of the function. The result is not kept for
+ * veo_call_wait_result() or veo_call_peek_result().
+ * The callback can submit requests, with callbacks too, but must not
+ * wait for another request with a callback.
+ */
+uint64_t veo_call_async_cb(veo_thr_ctxt *ctx, uint64_t addr, veo_args *args,
+                           veo_completion_cb cb, void *user)
+{
+  if (cb == nullptr)
+    return VEO_REQUEST_ID_INVALID;
+  try {
+    return ThreadContextFromC(ctx)->callAsync(addr, *CallArgsFromC(args),
+                                              cb, user);
+  } catch (VEOException &e) {
+    return VEO_REQUEST_ID_INVALID;
+  }
+}
+
+/**
+ * @brief request a VE thread to call a function with priority
+ *
+ * @param ctx VEO context to execute the function on VE.
+ * @param addr VEMVA of the function to call
+ * @param args arguments to be passed to the function
+ * @param prio VEO_PRIO_NORMAL or VEO_PRIO_HIGH
+ * @return request ID
+ * @retval VEO_REQUEST_ID_INVALID request failed.
+ *
+ * A request with VEO_PRIO_HIGH is executed before requests with
+ * VEO_PRIO_NORMAL which are not started yet. Requests with the same
+ * priority are executed in the order of submission.
+ */
+uint64_t veo_call_async_prio(veo_thr_ctxt *ctx, uint64_t addr,
+                             veo_args *args, int prio)
+{
+  try {
+    return ThreadContextFromC(ctx)->callAsync(addr, *CallArgsFromC(args),
+                                              nullptr, nullptr, prio);
+  } catch (VEOException &e) {
+    return VEO_REQUEST_ID_INVALID;
+  }
+}
+
+/**
+ * @brief request a VE thread to call functions in a batch
+ *
+ * @param ctx VEO context to execute the functions on VE.
+ * @param n the number of calls
+ * @param addrs array of VEMVAs of the functions to call
+ * @param args array of arguments to be passed to the functions
+ * @param[out] ids array to store request IDs of the calls
+ * @return the number of calls submitted; ids of calls not submitted are
+ *         set to VEO_REQUEST_ID_INVALID.
+ * @retval -1 request failed.
+ *
+ * The calls are enqueued at once under consecutive request IDs.
+ * The result of each call is obtained by veo_call_wait_result() or
+ * veo_call_peek_result() with its request ID as usual.
+ */
+int veo_call_async_batch(veo_thr_ctxt *ctx, int n, const uint64_t *addrs,
+                         veo_args *const *args, uint64_t *ids)
+{
+  try {
+    return ThreadContextFromC(ctx)->callAsyncBatch(n, addrs,
+             reinterpret_cast<veo::CallArgs *const *>(args), ids);
+  } catch (VEOException &e) {
+    return -1;
+  }
+}
+
 /**
  * @brief call a VH function asynchronously
  *
@@ -477,6 +601,7 @@ uint64_t veo_call_async_vh(veo_thr_ctxt *ctx, uint64_t (*func)(void *),
  * @retval VEO_COMMAND_EXCEPTION an exception occurred on function.
  * @retval VEO_COMMAND_ERROR an error occurred on function.
  * @retval VEO_COMMAND_UNFINISHED function is not finished.
+ * @retval VEO_COMMAND_CANCELLED the request was cancelled.
  * @retval -1 internal error.
  */
 int veo_call_peek_result(veo_thr_ctxt *ctx, uint64_t reqid, uint64_t *retp)
@@ -498,6 +623,7 @@ int veo_call_peek_result(veo_thr_ctxt *ctx, uint64_t reqid, uint64_t *retp)
  * @retval VEO_COMMAND_EXCEPTION an exception occurred on execution.
  * @retval VEO_COMMAND_ERROR an error occurred on execution.
  * @retval VEO_COMMAND_UNFINISHED function is not finished.
+ * @retval VEO_COMMAND_CANCELLED the request was cancelled.
  * @retval -1 internal error.
  */
 int veo_call_wait_result(veo_thr_ctxt *ctx, uint64_t reqid, uint64_t *retp)
@@ -509,6 +635,440 @@ int veo_call_wait_result(veo_thr_ctxt *ctx, uint64_t reqid, uint64_t *retp)
   }
 }
 
+/**
+ * @brief pick up a result from VE function waiting for a bounded time
+ *
+ * @param ctx VEO context
+ * @param reqid request ID
+ * @param timeout_ns timeout in nanoseconds; negative to wait infinitely.
+ * @param retp pointer to buffer to store the return value from the function.
+ * @retval VEO_COMMAND_OK function is successfully returned.
+ * @retval VEO_COMMAND_EXCEPTION an exception occurred on execution.
+ * @retval VEO_COMMAND_ERROR an error occurred on execution.
+ * @retval VEO_COMMAND_UNFINISHED function is not finished before timeout.
+ * @retval VEO_COMMAND_CANCELLED the request was cancelled.
+ * @retval -1 internal error.
+ *
+ * On timeout, the request is kept outstanding; its result can be picked
+ * up later by veo_call_wait_result() or veo_call_peek_result().
+ */
+int veo_call_wait_result_timed(veo_thr_ctxt *ctx, uint64_t reqid,
+                               int64_t timeout_ns, uint64_t *retp)
+{
+  try {
+    return ThreadContextFromC(ctx)->callWaitResult(reqid, retp, timeout_ns);
+  } catch (VEOException &e) {
+    return -1;
+  }
+}
+
+/**
+ * @brief cancel a request which has not started yet
+ *
+ * @param ctx VEO context
+ * @param reqid request ID
+ * @retval 0 the request is cancelled.
+ * @retval -1 the request has already started or finished, or is invalid.
+ *
+ * A cancelled request completes with VEO_COMMAND_CANCELLED and a return
+ * value of zero; pick up the result by veo_call_wait_result() or
+ * veo_call_peek_result() as usual. If a callback is set to the request,
+ * it is invoked with VEO_COMMAND_CANCELLED.
+ * Function calls, VH calls and memory transfers can be cancelled.
+ */
+int veo_call_cancel(veo_thr_ctxt *ctx, uint64_t reqid)
+{
+  try {
+    return ThreadContextFromC(ctx)->callCancel(reqid);
+  } catch (VEOException &e) {
+    return -1;
+  }
+}
+
+/**
+ * @brief cancel all requests which have not started yet on a VEO context
+ *
+ * @param ctx VEO context
+ * @return the number of requests cancelled
+ * @retval -1 internal error.
+ *
+ * The request being executed is not affected. Each cancelled request
+ * completes as by veo_call_cancel().
+ */
+int veo_call_cancel_all(veo_thr_ctxt *ctx)
+{
+  try {
+    return ThreadContextFromC(ctx)->callCancelAll();
+  } catch (VEOException &e) {
+    return -1;
+  }
+}
+
+/**
+ * @brief wait for the first result among requests on VEO contexts
+ *
+ * @param reqs array of pairs of VEO context and request ID
+ * @param n the number of requests
+ * @param timeout timeout in milliseconds; negative to wait infinitely.
+ * @param[out] index pointer to store the index of the request finished.
+ * @param retp pointer to buffer to store the return value from the function.
+ * @retval VEO_COMMAND_OK function is successfully returned.
+ * @retval VEO_COMMAND_EXCEPTION an exception occurred on execution.
+ * @retval VEO_COMMAND_ERROR an error occurred on execution.
+ * @retval VEO_COMMAND_CANCELLED the request was cancelled.
+ * @retval VEO_COMMAND_UNFINISHED no request finished before timeout.
+ * @retval -1 internal error.
+ *
+ * The requests can be on different contexts and processes. The result
+ * of only the request at *index is picked up.
+ */
+int veo_call_wait_any(const veo_request *reqs, int n, int timeout,
+                      int *index, uint64_t *retp)
+{
+  try {
+    return veo::ThreadContext::waitAny(reqs, n, TimeoutToNs(timeout),
+                                       index, retp);
+  } catch (VEOException &e) {
+    return -1;
+  }
+}
+
+/**
+ * @brief wait for the first result among requests with a timeout in ns
+ *
+ * @param reqs array of pairs of VEO context and request ID
+ * @param n the number of requests
+ * @param timeout_ns timeout in nanoseconds; negative to wait infinitely.
+ * @param[out] index pointer to store the index of the request finished.
+ * @param retp pointer to buffer to store the return value from the function.
+ * @retval VEO_COMMAND_OK function is successfully returned.
+ * @retval VEO_COMMAND_EXCEPTION an exception occurred on execution.
+ * @retval VEO_COMMAND_ERROR an error occurred on execution.
+ * @retval VEO_COMMAND_CANCELLED the request was cancelled.
+ * @retval VEO_COMMAND_UNFINISHED no request finished before timeout.
+ * @retval -1 internal error.
+ *
+ * The same as veo_call_wait_any() except for the unit of the timeout.
+ */
+int veo_call_wait_any_timed(const veo_request *reqs, int n,
+                            int64_t timeout_ns, int *index, uint64_t *retp)
+{
+  try {
+    return veo::ThreadContext::waitAny(reqs, n, timeout_ns, index, retp);
+  } catch (VEOException &e) {
+    return -1;
+  }
+}
+
+/**
+ * @brief wait for results of some of requests on VEO contexts
+ *
+ * @param reqs array of pairs of VEO context and request ID
+ * @param n the number of requests
+ * @param timeout timeout in milliseconds; negative to wait infinitely.
+ * @param[out] status array to store the status of each request;
+ *             VEO_COMMAND_CANCELLED for requests cancelled and
+ *             VEO_COMMAND_UNFINISHED for requests not finished.
+ * @param[out] retvals array to store the return value of each request.
+ * @return the number of requests finished, whose results are picked up.
+ * @retval 0 no request finished before timeout.
+ * @retval -1 internal error.
+ */
+int veo_call_wait_some(const veo_request *reqs, int n, int timeout,
+                       int *status, uint64_t *retvals)
+{
+  try {
+    return veo::ThreadContext::waitSome(reqs, n, TimeoutToNs(timeout),
+                                        status, retvals);
+  } catch (VEOException &e) {
+    return -1;
+  }
+}
+
+/**
+ * @brief wait for results of some of requests with a timeout in ns
+ *
+ * @param reqs array of pairs of VEO context and request ID
+ * @param n the number of requests
+ * @param timeout_ns timeout in nanoseconds; negative to wait infinitely.
+ * @param[out] status array to store the status of each request;
+ *             VEO_COMMAND_CANCELLED for requests cancelled and
+ *             VEO_COMMAND_UNFINISHED for requests not finished.
+ * @param[out] retvals array to store the return value of each request.
+ * @return the number of requests finished, whose results are picked up.
+ * @retval 0 no request finished before timeout.
+ * @retval -1 internal error.
+ *
+ * The same as veo_call_wait_some() except for the unit of the timeout.
+ */
+int veo_call_wait_some_timed(const veo_request *reqs, int n,
+                             int64_t timeout_ns, int *status,
+                             uint64_t *retvals)
+{
+  try {
+    return veo::ThreadContext::waitSome(reqs, n, timeout_ns, status,
+                                        retvals);
+  } catch (VEOException &e) {
+    return -1;
+  }
+}
+
+/**
+ * @brief create an event to order requests across VEO contexts
+ *
+ * @return pointer to event; NULL upon failure.
+ */
+veo_event *veo_event_create(void)
+{
+  try {
+    auto rv = new veo::Event();
+    return rv->toCHandle();
+  } catch (std::bad_alloc &e) {
+    errno = ENOMEM;
+    return NULL;
+  }
+}
+
+/**
+ * @brief destroy an event
+ *
+ * @param ev event
+ * @retval 0 upon success.
+ *
+ * Requests recording or waiting for the event must have finished.
+ */
+int veo_event_destroy(veo_event *ev)
+{
+  delete EventFromC(ev);
+  return 0;
+}
+
+/**
+ * @brief record an event on a VEO context
+ *
+ * @param ctx VEO context
+ * @param ev event
+ * @retval 0 upon success.
+ * @retval -1 upon failure, e.g. the last record of ev is on another
+ *         context and has not been reached yet.
+ *
+ * The event is reached when all requests submitted to ctx before this
+ * call have finished. Recording the event again replaces the point
+ * waited for by later veo_event_wait() and veo_event_synchronize().
+ * An event can be recorded on another context once its last record is
+ * reached, e.g. after veo_event_synchronize().
+ */
+int veo_event_record(veo_thr_ctxt *ctx, veo_event *ev)
+{
+  try {
+    return ThreadContextFromC(ctx)->recordEvent(EventFromC(ev));
+  } catch (VEOException &e) {
+    return -1;
+  }
+}
+
+/**
+ * @brief make requests on a VEO context wait for an event
+ *
+ * @param ctx VEO context
+ * @param ev event
+ * @retval 0 upon success.
+ * @retval -1 upon failure.
+ *
+ * Requests submitted to ctx after this call start after the last record
+ * of the event before this call is reached, typically on another
+ * context. The dependency is resolved by the pseudo thread of ctx;
+ * the calling thread does not block. Waiting for an event never recorded
+ * has no effect.
+ */
+int veo_event_wait(veo_thr_ctxt *ctx, veo_event *ev)
+{
+  try {
+    return ThreadContextFromC(ctx)->waitEvent(EventFromC(ev));
+  } catch (VEOException &e) {
+    return -1;
+  }
+}
+
+/**
+ * @brief wait for an event on the calling thread
+ *
+ * @param ev event
+ * @retval 0 upon success.
+ *
+ * The calling thread blocks until the last record of the event before
+ * this call is reached.
+ */
+int veo_event_synchronize(veo_event *ev)
+{
+  auto e = EventFromC(ev);
+  e->wait(e->lastRecord());
+  return 0;
+}
+
+/**
+ * @brief check if an event is reached
+ *
+ * @param ev event
+ * @retval VEO_COMMAND_OK the last record of the event is reached.
+ * @retval VEO_COMMAND_UNFINISHED the last record is not reached yet.
+ */
+int veo_event_query(veo_event *ev)
+{
+  auto e = EventFromC(ev);
+  return e->isReached(e->lastRecord()) ? VEO_COMMAND_OK
+                                       : VEO_COMMAND_UNFINISHED;
+}
+
+/**
+ * @brief start capturing requests on a VEO context into a graph
+ *
+ * @param ctx VEO context
+ * @retval 0 upon success.
+ * @retval -1 upon failure, e.g. ctx is already capturing.
+ *
+ * While capturing, function calls, VH calls and memory transfers
+ * submitted to ctx are not executed but recorded into a graph.
+ * The submission functions return the index of the node in the graph
+ * instead of a request ID; do not wait for it.
+ * Symbols are resolved at capture; arguments are referred to by the
+ * nodes as by veo_call_async(), not copied.
+ * Requests with callbacks and events cannot be captured.
+ */
+int veo_graph_begin_capture(veo_thr_ctxt *ctx)
+{
+  try {
+    return ThreadContextFromC(ctx)->beginCapture();
+  } catch (std::bad_alloc &e) {
+    return -1;
+  }
+}
+
+/**
+ * @brief stop capturing requests on a VEO context
+ *
+ * @param ctx VEO context
+ * @return the graph captured; NULL if ctx is not capturing.
+ */
+veo_graph *veo_graph_end_capture(veo_thr_ctxt *ctx)
+{
+  auto g = ThreadContextFromC(ctx)->endCapture();
+  return g != nullptr ? g->toCHandle() : NULL;
+}
+
+/**
+ * @brief replay a graph on a VEO context
+ *
+ * @param ctx VEO context
+ * @param g graph
+ * @return request ID
+ * @retval VEO_REQUEST_ID_INVALID request failed.
+ *
+ * The nodes of the graph are executed in the order of capture by one
+ * request. The nodes are executed until one of them fails; the result of
+ * the request is the result of the last node executed.
+ * The arguments of calls are marshalled on the first launch and reused
+ * by later launches unless they are set to buffers of another layout;
+ * the values of arguments and the data of VEO_INTENT_IN buffers on stack
+ * are read at each launch and the data of VEO_INTENT_OUT buffers is
+ * written back.
+ * The arguments must be kept alive while the graph exists.
+ * A graph must not be launched again before the previous launch finishes.
+ */
+uint64_t veo_graph_launch(veo_thr_ctxt *ctx, veo_graph *g)
+{
+  try {
+    return ThreadContextFromC(ctx)->launchGraph(GraphFromC(g));
+  } catch (VEOException &e) {
+    return VEO_REQUEST_ID_INVALID;
+  }
+}
+
+/**
+ * @brief destroy a graph
+ *
+ * @param g graph
+ * @retval 0 upon success.
+ *
+ * The graph must not be in launch.
+ */
+int veo_graph_destroy(veo_graph *g)
+{
+  delete GraphFromC(g);
+  return 0;
+}
+
+/**
+ * @brief create a plan of function calls
+ *
+ * @param ctx VEO context to call the function on
+ * @param addr VEMVA of VE function
+ * @param args arguments of the function
+ * @return call plan; NULL upon failure.
+ *
+ * A call plan calls the function with args repeatedly at a lower cost
+ * than veo_call_async(). The layout of the arguments on stack is made
+ * on the first launch, and later launches only write the values of the
+ * arguments set by veo_args_set_*() and the data of VEO_INTENT_IN
+ * buffers on stack into it. Data on stack unchanged since the previous
+ * launch of the plan is not transferred again unless another function
+ * is called on ctx in between; the function must not modify its
+ * arguments on stack other than VEO_INTENT_OUT and VEO_INTENT_INOUT
+ * buffers.
+ * Adding, clearing or setting arguments on stack makes the layout again
+ * on the next launch.
+ * The arguments must be kept alive while the plan exists.
+ */
+veo_call_plan *veo_call_plan_create(veo_thr_ctxt *ctx, uint64_t addr,
+                                    veo_args *args)
+{
+  if (addr == 0 || args == NULL)
+    return NULL;
+  try {
+    auto p = new veo::CallPlan(ThreadContextFromC(ctx), addr,
+                               CallArgsFromC(args));
+    return p->toCHandle();
+  } catch (std::bad_alloc &e) {
+    return NULL;
+  }
+}
+
+/**
+ * @brief launch a plan of function calls
+ *
+ * @param plan call plan
+ * @return request ID on the context of the plan
+ * @retval VEO_REQUEST_ID_INVALID request failed.
+ *
+ * Pick up the result by veo_call_wait_result() or veo_call_peek_result()
+ * on the context of the plan.
+ * The arguments are read when the call starts; they must not be changed
+ * until the launch finishes.
+ */
+uint64_t veo_call_plan_launch(veo_call_plan *plan)
+{
+  try {
+    auto p = CallPlanFromC(plan);
+    return p->getContext()->launchPlan(p);
+  } catch (VEOException &e) {
+    return VEO_REQUEST_ID_INVALID;
+  }
+}
+
+/**
+ * @brief destroy a plan of function calls
+ *
+ * @param plan call plan
+ * @retval 0 upon success.
+ *
+ * The plan must not be in launch.
+ */
+int veo_call_plan_destroy(veo_call_plan *plan)
+{
+  delete CallPlanFromC(plan);
+  return 0;
+}
+
 /**
  * @brief Allocate a VE memory buffer
  *
@@ -626,6 +1186,152 @@ uint64_t veo_async_write_mem(veo_thr_ctxt *ctx, uint64_t dst, const void *src,
   }
 }
 
+/**
+ * @brief Asynchronously read VE memory with a callback
+ *
+ * @param ctx VEO context
+ * @param dst destination VHVA
+ * @param src source VEMVA
+ * @param size size in byte
+ * @param cb callback invoked on completion
+ * @param user pointer passed to the callback
+ * @return request ID
+ * @retval VEO_REQUEST_ID_INVALID request failed.
+ */
+uint64_t veo_async_read_mem_cb(veo_thr_ctxt *ctx, void *dst, uint64_t src,
+                               size_t size, veo_completion_cb cb, void *user)
+{
+  if (cb == nullptr)
+    return VEO_REQUEST_ID_INVALID;
+  try {
+    return ThreadContextFromC(ctx)->asyncReadMem(dst, src, size, cb, user);
+  } catch (VEOException &e) {
+    return VEO_REQUEST_ID_INVALID;
+  }
+}
+
+/**
+ * @brief Asynchronously write VE memory with a callback
+ *
+ * @param ctx VEO context
+ * @param dst destination VEMVA
+ * @param src source VHVA
+ * @param size size in byte
+ * @param cb callback invoked on completion
+ * @param user pointer passed to the callback
+ * @return request ID
+ * @retval VEO_REQUEST_ID_INVALID request failed.
+ */
+uint64_t veo_async_write_mem_cb(veo_thr_ctxt *ctx, uint64_t dst,
+                                const void *src, size_t size,
+                                veo_completion_cb cb, void *user)
+{
+  if (cb == nullptr)
+    return VEO_REQUEST_ID_INVALID;
+  try {
+    return ThreadContextFromC(ctx)->asyncWriteMem(dst, src, size, cb, user);
+  } catch (VEOException &e) {
+    return VEO_REQUEST_ID_INVALID;
+  }
+}
+
+/**
+ * @brief Asynchronously read VE memory with priority
+ *
+ * @param ctx VEO context
+ * @param dst destination VHVA
+ * @param src source VEMVA
+ * @param size size in byte
+ * @param prio VEO_PRIO_NORMAL or VEO_PRIO_HIGH
+ * @return request ID
+ * @retval VEO_REQUEST_ID_INVALID request failed.
+ *
+ * See veo_call_async_prio() for the order of execution.
+ */
+uint64_t veo_async_read_mem_prio(veo_thr_ctxt *ctx, void *dst, uint64_t src,
+                                 size_t size, int prio)
+{
+  try {
+    return ThreadContextFromC(ctx)->asyncReadMem(dst, src, size,
+                                                 nullptr, nullptr, prio);
+  } catch (VEOException &e) {
+    return VEO_REQUEST_ID_INVALID;
+  }
+}
+
+/**
+ * @brief Asynchronously write VE memory with priority
+ *
+ * @param ctx VEO context
+ * @param dst destination VEMVA
+ * @param src source VHVA
+ * @param size size in byte
+ * @param prio VEO_PRIO_NORMAL or VEO_PRIO_HIGH
+ * @return request ID
+ * @retval VEO_REQUEST_ID_INVALID request failed.
+ *
+ * See veo_call_async_prio() for the order of execution.
+ */
+uint64_t veo_async_write_mem_prio(veo_thr_ctxt *ctx, uint64_t dst,
+                                  const void *src, size_t size, int prio)
+{
+  try {
+    return ThreadContextFromC(ctx)->asyncWriteMem(dst, src, size,
+                                                  nullptr, nullptr, prio);
+  } catch (VEOException &e) {
+    return VEO_REQUEST_ID_INVALID;
+  }
+}
+
+/**
+ * @brief Asynchronously read VE memory in a batch
+ *
+ * @param ctx VEO context
+ * @param n the number of transfers
+ * @param dst array of destination VHVAs
+ * @param src array of source VEMVAs
+ * @param size array of sizes in byte
+ * @param[out] ids array to store request IDs of the transfers
+ * @return the number of transfers submitted; ids of transfers not
+ *         submitted are set to VEO_REQUEST_ID_INVALID.
+ * @retval -1 request failed.
+ */
+int veo_async_read_mem_batch(veo_thr_ctxt *ctx, int n, void *const *dst,
+                             const uint64_t *src, const size_t *size,
+                             uint64_t *ids)
+{
+  try {
+    return ThreadContextFromC(ctx)->asyncReadMemBatch(n, dst, src, size, ids);
+  } catch (VEOException &e) {
+    return -1;
+  }
+}
+
+/**
+ * @brief Asynchronously write VE memory in a batch
+ *
+ * @param ctx VEO context
+ * @param n the number of transfers
+ * @param dst array of destination VEMVAs
+ * @param src array of source VHVAs
+ * @param size array of sizes in byte
+ * @param[out] ids array to store request IDs of the transfers
+ * @return the number of transfers submitted; ids of transfers not
+ *         submitted are set to VEO_REQUEST_ID_INVALID.
+ * @retval -1 request failed.
+ */
+int veo_async_write_mem_batch(veo_thr_ctxt *ctx, int n, const uint64_t *dst,
+                              const void *const *src, const size_t *size,
+                              uint64_t *ids)
+{
+  try {
+    return ThreadContextFromC(ctx)->asyncWriteMemBatch(n, dst, src, size,
+                                                       ids);
+  } catch (VEOException &e) {
+    return -1;
+  }
+}
+
 /**
  * @brief allocate VEO arguments object (veo_args)
  *
@@ -777,7 +1483,8 @@ int veo_args_set_float(veo_args *ca, int argnum, float val)
  * @brief set VEO function calling argument pointing to buffer on stack
  *
  * @param ca pointer to veo_args object
- * @param inout intent of argument, currently only VEO_INTENT_IN is supported
+ * @param inout intent of argument: VEO_INTENT_IN, VEO_INTENT_INOUT or
+ *        VEO_INTENT_OUT
  * @param argnum argument number that is being set
  * @param buff char pointer to buffer that will be copied to the VE stack
  * @param len length of buffer that is copied to the VE stack
@@ -785,12 +1492,17 @@ int veo_args_set_float(veo_args *ca, int argnum, float val)
  * @retval -1 an error occurred.
  *
  * The buffer is copied to the stack and will look to the VE callee like a
- * local variable of the caller function. It is currently erased right after
- * the call returns, thus only intent IN args passing is supported. Use this
- * to pass structures to the VE "kernel" function. The size of arguments 
- * passed on the stack is limited to 63MB, since the size of the initial 
- * stack is 64MB. Try staying well below this value, allocate and use memory
- * buffers on heap when you have huge argument arrays to pass.
+ * local variable of the caller function. Use this to pass structures to
+ * the VE "kernel" function. IN and INOUT buffers are copied to VE before
+ * the call, and INOUT and OUT buffers are copied back after the call
+ * returns. Buffers smaller than 1MB are placed on the stack; their total
+ * size is limited to 63MB, since the size of the initial stack is 64MB.
+ * Buffers of 1MB or larger are not placed on the stack but in VE heap
+ * memory acquired around the call from a pool kept by the process; their
+ * size is not limited by the stack.
+ * The contents of an OUT buffer are undefined on VE when the call starts,
+ * either on the stack or on VE heap, where the memory can have been used
+ * by a previous call; the VE function must write all of it.
  */
 int veo_args_set_stack(veo_args *ca, enum veo_args_intent inout,
                        int argnum, char *buff, size_t len)
@@ -805,6 +1517,60 @@ int veo_args_set_stack(veo_args *ca, enum veo_args_intent inout,
   }
 }
 
+/**
+ * @brief set all arguments at once from a packed descriptor
+ *
+ * @param ca veo_args object
+ * @param n the number of arguments
+ * @param types array of n type codes (enum veo_arg_type)
+ * @param values block of the values packed in the order of arguments
+ *        without padding; need not be aligned.
+ * @retval 0 arguments are successfully set.
+ * @retval -1 n or a type code is invalid; the arguments are not changed.
+ *
+ * Arguments #0 to #n-1 are set as by veo_args_set_*() and
+ * veo_args_set_stack(); arguments from #n are removed.
+ * A scalar takes its own size in the block; an argument on stack
+ * (VEO_ARG_STACK_*) takes a char pointer to the buffer followed by
+ * the size_t length of it.
+ */
+int veo_args_set_packed(veo_args *ca, int n, const uint8_t *types,
+                        const void *values)
+{
+  try {
+    CallArgsFromC(ca)->setPacked(n, types, values);
+    return 0;
+  } catch (VEOException &e) {
+    VEO_ERROR(nullptr, "failed to set %d packed arguments: %s",
+              n, e.what());
+    return -1;
+  }
+}
+
+/**
+ * @brief enable or disable snapshot of arguments on submission
+ *
+ * @param ca veo_args object
+ * @param enable non-zero to take a snapshot on each call; zero to read
+ *        the arguments when the call starts (default).
+ * @retval 0 always.
+ *
+ * When enabled, veo_call_async() and its variants copy the values of
+ * arguments and the data of IN buffers on stack at submission, so that
+ * the arguments can be cleared or set again, and IN buffers reused, for
+ * the next call right away. OUT buffers are still written back to the
+ * VH buffers set, which must be kept until the call completes.
+ * The snapshot is also laid out on stack at submission unless it has
+ * buffers placed on VE heap, so that VE thread does not wait for
+ * the marshalling between calls.
+ * A call captured into a graph does not take a snapshot.
+ */
+int veo_args_set_snapshot(veo_args *ca, int enable)
+{
+  CallArgsFromC(ca)->setSnapshot(enable != 0);
+  return 0;
+}
+
 /**
  * @brief clear arguments set in VEO arguments object
  *
@@ -913,4 +1679,50 @@ int veo_get_thr_ctxt_stacksize(veo_thr_ctxt_attr *tca, size_t *stack_sz)
   *stack_sz = ThreadContextAttrFromC(tca)->getStacksize();
   return 0;
 }
+
+/**
+ * @brief set the policy of waiting for results on VEO contexts
+ *
+ * @param tca veo_thr_ctxt_attr object
+ * @param policy VEO_WAIT_PARK to sleep at once (default),
+ *        VEO_WAIT_SPIN to busy-wait, or VEO_WAIT_ADAPTIVE to busy-wait
+ *        for an interval tuned by recent wait times and then sleep.
+ *
+ * @return 0 upon success; -1 upon failure.
+ *
+ * The policy applies to veo_call_wait_result() on contexts opened
+ * with the attributes.
+ */
+int veo_set_thr_ctxt_wait_policy(veo_thr_ctxt_attr *tca, int policy)
+{
+  if (tca == nullptr) {
+    errno = EINVAL;
+    return -1;
+  }
+  try {
+    ThreadContextAttrFromC(tca)->setWaitPolicy(policy);
+  } catch (VEOException &e) {
+    errno = e.err();
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief get the policy of waiting for results on VEO contexts
+ *
+ * @param tca veo_thr_ctxt_attr object
+ * @param policy pointer to store the wait policy.
+ *
+ * @return 0 upon success; -1 upon failure.
+ */
+int veo_get_thr_ctxt_wait_policy(veo_thr_ctxt_attr *tca, int *policy)
+{
+  if (tca == nullptr || policy == nullptr) {
+    errno = EINVAL;
+    return -1;
+  }
+  *policy = ThreadContextAttrFromC(tca)->getWaitPolicy();
+  return 0;
+}
 //@}
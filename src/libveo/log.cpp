@@ -19,7 +19,10 @@ log4c_category_t *log_category_;
 void veo__vlog(const ThreadContext *ctx, const log4c_location_info_t *loc,
                int prio, const char *fmt, va_list list)
 {
-  //TODO: switch to disable logging for performance
+  // Return before building the format string so that disabled trace
+  // messages on the request path cost neither the lock nor an allocation.
+  if (!log4c_category_is_priority_enabled(log::log_category_, prio))
+    return;
   // ctx can be nullptr.
   std::lock_guard<std::mutex> lock(log::log_mtx_);
   std::string newfmt;